@@ -0,0 +1,320 @@
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+/* Microbenchmarks of the numerical kernels of the exchange algorithm.
+ *
+ * Every kernel is run for double, long double and (if available) MPFR
+ * numbers, on several problem sizes: the size of the reference set for the
+ * barycentric kernels, band conversions and reference scaling, and the
+ * number of Chebyshev coefficients for the kernels used on each subinterval
+ * of the extrema search. Besides the timings, each benchmark reports its
+ * throughput (items per second) and the number of heap allocations per
+ * iteration (those done through operator new; GMP/MPFR allocate their
+ * significands with their own allocator and are not counted).
+ *
+ * The output is made machine readable with the options of Google
+ * Benchmark, for instance
+ *     firpm_bench --benchmark_format=json --benchmark_out=kernels.json
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "firpm.h"
+#include "benchmark/benchmark.h"
+
+#ifdef HAVE_MPFR
+    #include <unsupported/Eigen/MPRealSupport>
+#endif
+
+static std::atomic<std::size_t> allocs{0u};
+
+/* The allocation counter replaces the whole set of global allocation
+ * functions, so that every form of new is paired with its delete. */
+static void* countedalloc(std::size_t size)
+{
+    allocs.fetch_add(1u, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1u))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) { return countedalloc(size); }
+void* operator new[](std::size_t size) { return countedalloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace pm;
+
+// counts the allocations of the timed loop of a benchmark
+class alloccount_t {
+public:
+    explicit alloccount_t(benchmark::State& state)
+        : state(state), start(allocs.load()) {}
+    ~alloccount_t() {
+        state.counters["allocs"] = benchmark::Counter(
+                (double)(allocs.load() - start),
+                benchmark::Counter::kAvgIterations);
+    }
+private:
+    benchmark::State& state;
+    std::size_t start;
+};
+
+// precision of the MPFR numbers used by the benchmarks
+static const unsigned long BENCH_PREC = 165ul;
+
+/* nb bands of equal widths covering [0, pi], separated by transition
+ * bands of half their width, with alternating amplitudes 1 and 0 and
+ * weights 1 and 10. */
+template<typename T>
+static void mkbands(std::vector<band_t<T>>& fbands, std::size_t nb)
+{
+    T width = pmmath::const_pi<T>() / (nb + (nb - 1u) / T(2));
+    fbands.resize(nb);
+    for(std::size_t i{0u}; i < nb; ++i) {
+        T start = width * i * 3 / 2;
+        std::vector<T> freq = {start, (i + 1u == nb) ? pmmath::const_pi<T>()
+                                                     : start + width};
+        T amp = (i % 2u == 0u) ? 1 : 0;
+        pwlinit(fbands[i], freq, {amp, amp}, T((i % 2u == 0u) ? 1 : 10));
+    }
+}
+
+/* Problem setup: the bands of a lowpass filter, in both spaces, with a
+ * uniform reference of n points and the corresponding barycentric weights
+ * and values of the interpolating filter at the reference. */
+template<typename T>
+struct problem_t {
+    std::vector<band_t<T>> fbands;
+    std::vector<band_t<T>> cbands;
+    std::vector<T> x;
+    std::vector<T> w;
+    std::vector<T> C;
+    std::vector<T> xVal;
+    T delta;
+
+    explicit problem_t(std::size_t n) {
+        mkbands(fbands, 2u);
+        std::vector<T> omega;
+        uniform(omega, fbands, n);
+        cos(x, omega);
+        std::sort(x.begin(), x.end());
+        bandconv(cbands, fbands, convdir_t::FROMFREQ);
+
+        // the outputs of the kernels are sized by their callers
+        w.resize(x.size());
+        C.resize(x.size());
+        baryweights(w, x);
+        compdelta(delta, w, x, cbands);
+        compc(C, delta, x, cbands);
+        // points between those of the reference, where the error is
+        // evaluated by the extrema search
+        for(std::size_t i{0u}; i + 1u < x.size(); ++i)
+            xVal.push_back((x[i] + x[i + 1u]) / 2);
+    }
+};
+
+template<typename T>
+static void BM_baryweights(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    problem_t<T> p(state.range(0));
+    std::vector<T> w(p.x.size());
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            baryweights(w, p.x);
+            benchmark::DoNotOptimize(w.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.x.size());
+}
+
+template<typename T>
+static void BM_compdelta(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    problem_t<T> p(state.range(0));
+    T delta;
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            compdelta(delta, p.w, p.x, p.cbands);
+            benchmark::DoNotOptimize(delta);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.x.size());
+}
+
+template<typename T>
+static void BM_comperror(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    problem_t<T> p(state.range(0));
+    std::vector<T> error;
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            comperror(error, p.xVal, p.delta, p.x, p.C, p.w, p.cbands);
+            benchmark::DoNotOptimize(error.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.xVal.size());
+}
+
+template<typename T>
+static void BM_approx(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    problem_t<T> p(state.range(0));
+    std::vector<T> Pc;
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            approx(Pc, p.xVal, p.x, p.C, p.w);
+            benchmark::DoNotOptimize(Pc.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.xVal.size());
+}
+
+/* The band conversion only depends on the number of bands. */
+template<typename T>
+static void BM_bandconv(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    std::vector<band_t<T>> fbands, cbands;
+    mkbands(fbands, state.range(0));
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            bandconv(cbands, fbands, convdir_t::FROMFREQ);
+            benchmark::DoNotOptimize(cbands.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * fbands.size());
+}
+
+template<typename T>
+static void BM_refscaling(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    problem_t<T> p(state.range(0));
+    std::size_t nxs = 2u * p.x.size() - 2u;
+    // the new bands start as copies of the old ones, as in firpm (which
+    // updates them in place)
+    std::vector<band_t<T>> ncbands{p.cbands}, nfbands{p.fbands};
+    std::vector<T> nx;
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            status_t status;
+            nx.clear();
+            refscaling(status, nx, ncbands, nfbands, nxs, p.x, p.cbands, p.fbands);
+            benchmark::DoNotOptimize(nx.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nxs);
+}
+
+/* Kernels of the extrema search, for an interpolant with n + 1 Chebyshev
+ * coefficients on a subinterval (n is the nmax parameter of firpm). */
+template<typename T>
+struct cheb_t {
+    std::vector<T> fv;
+    std::vector<T> c;
+    std::vector<T> dc;
+
+    explicit cheb_t(std::size_t n) {
+        auto nodes = chebpts<T>(n + 1u);
+        for(auto const& it : *nodes)
+            fv.push_back(pmmath::cos(T(7) * it) + it * it * it);
+        c.resize(fv.size());
+        chebcoeffs(c, fv);
+        diffcoeffs(dc, c);
+    }
+};
+
+template<typename T>
+static void BM_chebcoeffs(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    cheb_t<T> p(state.range(0));
+    std::vector<T> c(p.fv.size());
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            chebcoeffs(c, p.fv);
+            benchmark::DoNotOptimize(c.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.fv.size());
+}
+
+template<typename T>
+static void BM_diffcoeffs(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    cheb_t<T> p(state.range(0));
+    std::vector<T> dc;
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            diffcoeffs(dc, p.c);
+            benchmark::DoNotOptimize(dc.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.c.size());
+}
+
+/* The colleague matrix and its balancing are internal to roots(), they are
+ * measured through it, with and without balancing. */
+template<typename T>
+static void BM_roots(benchmark::State& state)
+{
+    precscope_t<T> scope(BENCH_PREC);
+    cheb_t<T> p(state.range(0));
+    std::pair<T, T> dom{-1, 1};
+    bool balance = (state.range(1) != 0);
+    std::vector<T> r;
+    {
+        alloccount_t count(state);
+        for(auto _ : state) {
+            r.clear();
+            roots(r, p.dc, dom, SECOND, balance);
+            benchmark::DoNotOptimize(r.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * p.dc.size());
+}
+
+#define BENCH_REFERENCE(kernel, T, maxn) \
+    BENCHMARK_TEMPLATE(kernel, T)->RangeMultiplier(8)->Range(64, maxn)
+#define BENCH_SUBINTERVAL(kernel, T) \
+    BENCHMARK_TEMPLATE(kernel, T)->RangeMultiplier(4)->Range(8, 128)
+#define BENCH_ROOTS(T) \
+    BENCHMARK_TEMPLATE(BM_roots, T)->ArgsProduct({{8, 32, 128}, {0, 1}})
+
+#define BENCH_TYPE(T, maxn) \
+    BENCH_REFERENCE(BM_baryweights, T, maxn); \
+    BENCH_REFERENCE(BM_compdelta, T, maxn); \
+    BENCH_REFERENCE(BM_comperror, T, maxn); \
+    BENCH_REFERENCE(BM_approx, T, maxn); \
+    BENCHMARK_TEMPLATE(BM_bandconv, T)->RangeMultiplier(4)->Range(2, 32); \
+    BENCH_REFERENCE(BM_refscaling, T, maxn); \
+    BENCH_SUBINTERVAL(BM_chebcoeffs, T); \
+    BENCH_SUBINTERVAL(BM_diffcoeffs, T); \
+    BENCH_ROOTS(T)
+
+BENCH_TYPE(double, 4096);
+BENCH_TYPE(long double, 4096);
+#ifdef HAVE_MPFR
+BENCH_TYPE(mpfr::mpreal, 512);
+#endif
+
+BENCHMARK_MAIN();
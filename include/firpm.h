@@ -13,7 +13,9 @@
 
 #include "firpm/band.h"
 #include "firpm/barycentric.h"
+#include "firpm/cache.h"
 #include "firpm/cheby.h"
+#include "firpm/ddouble.h"
 #include "firpm/pm.h"
 #include "firpm/pmmath.h"
 
@@ -12,6 +12,7 @@
 #define __PMBAND_H__
 
 #include "util.h"
+#include "pmmath.h"
 
 namespace pm {
     /**
@@ -25,6 +26,29 @@ namespace pm {
                         (i.e., we are in \f$\left[-1, 1\right]\f$) */
     };
 
+    /**
+     * @brief Piecewise-linear description of the ideal amplitude of a band
+     *
+     * The amplitude is linear in \f$\omega\f$ on each segment and the
+     * weight is constant over the band. The breakpoints are also stored
+     * in the \f$\left[-1,1\right]\f$ space, so that the amplitude on flat
+     * segments can be evaluated there without going back to \f$\omega\f$.
+     * A band carrying such a description (see <tt>pwlinit</tt>) is evaluated
+     * directly by the exchange algorithm, without calling its amplitude and
+     * weight functions.
+     */
+    template<typename T>
+    struct pwl_t {
+        std::vector<T> freq;    /**< segment breakpoints in \f$\left[0, \pi\right]\f$
+                                (in increasing order) */
+        std::vector<T> cheby;   /**< the breakpoints after the change of variable
+                                \f$y=\cos(x)\f$ */
+        std::vector<T> amp;     /**< amplitudes at the two ends of each segment */
+        T weight;               /**< weight value on the band */
+        bool halfcos{false};    /**< divide the amplitude and multiply the weight
+                                by \f$\cos(\omega/2)\f$ (type II filters) */
+    };
+
     /**
      * @brief A data type encapsulating information relevant to a
      * frequency band
@@ -43,8 +67,84 @@ namespace pm {
                                 /**< weight function value on the band */
         std::size_t xs;         /**< number of interpolation points taken in the band */
         std::vector<T> part;    /**< partition points (if any) inside the band */
+        pwl_t<T> pwl;           /**< piecewise-linear description of the band
+                                (empty if the band is only described by its
+                                amplitude and weight functions) */
     };
 
+    /*! Evaluates the ideal amplitude of a band with a piecewise-linear description
+    * @param[in] p the piecewise-linear band description
+    * @param[in] space the space in which x is given
+    * @param[in] x the point where the amplitude is evaluated
+    * @return the ideal amplitude at x
+    */
+    template<typename T>
+    inline T pwlamp(pwl_t<T> const& p, space_t space, T const& x)
+    {
+        // first segment (in increasing frequency order) which is not
+        // to the left of x; flat segments do not need x in frequency space
+        std::size_t ns = p.amp.size() / 2u;
+        std::size_t j{0u};
+        if (space == space_t::CHEBY) {
+            while (j + 1u < ns && x < p.cheby[j + 1u])
+                ++j;
+        } else {
+            while (j + 1u < ns && x > p.freq[j + 1u])
+                ++j;
+        }
+
+        T a;
+        if (p.amp[2u * j] != p.amp[2u * j + 1u]) {
+            T fx = (space == space_t::CHEBY) ? pmmath::acos(x) : x;
+            a = ((fx - p.freq[j]) * p.amp[2u * j + 1u] -
+                    (fx - p.freq[j + 1u]) * p.amp[2u * j]) /
+                    (p.freq[j + 1u] - p.freq[j]);
+        } else {
+            a = p.amp[2u * j];
+        }
+        if (p.halfcos) {
+            if (space == space_t::FREQ)
+                return a / pmmath::cos(x / 2);
+            else
+                return a / pmmath::sqrt((x + 1) / 2);
+        }
+        return a;
+    }
+
+    /*! Evaluates the weight of a band with a piecewise-linear description
+    * @param[in] p the piecewise-linear band description
+    * @param[in] space the space in which x is given
+    * @param[in] x the point where the weight is evaluated
+    * @return the weight value at x
+    */
+    template<typename T>
+    inline T pwlweight(pwl_t<T> const& p, space_t space, T const& x)
+    {
+        if (p.halfcos) {
+            if (space == space_t::FREQ)
+                return pmmath::cos(x / 2) * p.weight;
+            else
+                return pmmath::sqrt((x + 1) / 2) * p.weight;
+        }
+        return p.weight;
+    }
+
+    /*! Gives a frequency band a piecewise-linear amplitude and a constant
+    * weight. Besides the piecewise-linear description, the amplitude and
+    * weight functions of the band are also set, so that the band can be
+    * used by code that relies on them.
+    * @param[out] band the band to update (its start, stop, part and space
+    * members are also set)
+    * @param[in] freq the segment breakpoints in \f$\left[0, \pi\right]\f$,
+    * in increasing order
+    * @param[in] amp the amplitudes at the two ends of each segment
+    * (i.e., 2 * (freq.size() - 1) values)
+    * @param[in] weight the weight value on the band
+    */
+    template<typename T>
+    void pwlinit(band_t<T>& band, std::vector<T> const& freq,
+            std::vector<T> const& amp, T const& weight);
+
     /**
      * Gives the direction in which the change of variable is performed
      */
@@ -63,6 +163,18 @@ namespace pm {
     void bandconv(std::vector<band_t<T>>& out, std::vector<band_t<T>>& in,
             convdir_t direction);
 
+    /*! Converts a set of bands to another numeric type (for instance, to
+    * run the first iterations of a high precision design in double precision).
+    * The amplitude and weight functions of the output bands evaluate those of
+    * the input bands, while the band edges, partition points and piecewise-linear
+    * descriptions are converted directly.
+    * @param[out] out the converted bands
+    * @param[in] in the bands to convert
+    */
+    template<typename To, typename From>
+    void bandcast(std::vector<band_t<To>>& out,
+            std::vector<band_t<From>> const& in);
+
 } // namespace pm
 
 #endif
\ No newline at end of file
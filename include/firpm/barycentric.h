@@ -22,7 +22,9 @@ namespace pm {
         /*! Procedure which computes the weights used in
         * the evaluation of the barycentric interpolation
         * formulas (see [Berrut&Trefethen2004] and [Pachon&Trefethen2009]
-        * for the implementation ideas)
+        * for the implementation ideas). For large reference sets the products
+        * are accumulated with a separate binary exponent, and the weights are
+        * computed in parallel.
         * @param[out] w the computed weights
         * @param[in] x the interpolation points
         */
@@ -55,6 +57,20 @@ namespace pm {
         void compdelta(T& delta, std::vector<T>& w,
                 std::vector<T>& x, std::vector<band_t<T>>& bands);
 
+        /*! Determines the current reference error according to the
+        * barycentric formula, using precomputed ideal response and weight
+        * values at the reference set (see the vector version of
+        * <tt>idealvals</tt>)
+        * @param[out] delta the value of the current reference error
+        * @param[in] w the barycentric weights associated with the current reference
+        * set
+        * @param[in] D the ideal frequency response at the reference set
+        * @param[in] W the weight function values at the reference set
+        */
+        template<typename T>
+        void compdelta(T& delta, std::vector<T>& w,
+                std::vector<T>& D, std::vector<T>& W);
+
         /*! Computes the filter response at the current reference set
         * @param[out] C the vector of frequency responses at the reference set
         * @param[in] delta the current reference error
@@ -65,6 +81,17 @@ namespace pm {
         void compc(std::vector<T>& C, T& delta,
                 std::vector<T>& x, std::vector<band_t<T>>& bands);
 
+        /*! Computes the filter response at the current reference set, using
+        * precomputed ideal response and weight values at the reference set
+        * @param[out] C the vector of frequency responses at the reference set
+        * @param[in] delta the current reference error
+        * @param[in] D the ideal frequency response at the reference set
+        * @param[in] W the weight function values at the reference set
+        */
+        template<typename T>
+        void compc(std::vector<T>& C, T& delta,
+                std::vector<T>& D, std::vector<T>& W);
+
         /*! Computes the frequency response of the current filter
         * @param[out] Pc the frequency response amplitude value at the current node
         * @param[in] xVal the current frequency node where we do our computation
@@ -79,6 +106,24 @@ namespace pm {
                 std::vector<T>& x, std::vector<T>& C,
                 std::vector<T>& w);
 
+        /*! Computes the frequency response of the current filter at a set of nodes.
+        * The nodes are processed in blocks, with the double precision version
+        * using SIMD instructions (AVX2/AVX-512 when the library is compiled for
+        * them, compiler-vectorized code otherwise). The results are the same as
+        * those obtained by calling <tt>approx</tt> on each node.
+        * @param[out] Pc the frequency response amplitude values at the nodes of
+        * xVal
+        * @param[in] xVal the frequency nodes where we do our computation
+        * (the points are given in the \f$\left[-1,1\right]\f$ interval)
+        * @param[in] x the current reference set
+        * @param[in] C the frequency responses at the current reference set
+        * @param[in] w the current barycentric weights
+        */
+        template<typename T>
+        void approx(std::vector<T>& Pc, std::vector<T> const& xVal,
+                std::vector<T>& x, std::vector<T>& C,
+                std::vector<T>& w);
+
         /*! Computes the approximation error at a given node using the current set of
         * reference points
         * @param[out] error the requested error value
@@ -95,6 +140,35 @@ namespace pm {
                 std::vector<T>& C, std::vector<T>& w,
                 std::vector<band_t<T>>& bands);
 
+        /*! Computes the approximation error at a set of nodes using the current set
+        * of reference points. This is the batch counterpart of the pointwise
+        * <tt>comperror</tt> (see the batch <tt>approx</tt> for how the nodes are
+        * processed) and gives the same results.
+        * @param[out] error the error values at the nodes of xVal
+        * @param[in] xVal the frequency nodes where we do our computation
+        * @param[in] delta the current reference error
+        * @param[in] x the current reference set
+        * @param[in] C the frequency response values at the x nodes
+        * @param[in] w the barycentric weights
+        * @param[in] bands frequency band information for the ideal filter
+        */
+        template<typename T>
+        void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+                T& delta, std::vector<T>& x,
+                std::vector<T>& C, std::vector<T>& w,
+                std::vector<band_t<T>>& bands);
+
+        /*! Same as the batch <tt>comperror</tt> above, for callers that
+        * evaluate the error many times with the same bands and know whether
+        * they are ordered (see <tt>bandsorted</tt>)
+        * @param[in] sorted the value of <tt>bandsorted(bands)</tt>
+        */
+        template<typename T>
+        void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+                T& delta, std::vector<T>& x,
+                std::vector<T>& C, std::vector<T>& w,
+                std::vector<band_t<T>>& bands, bool sorted);
+
         /*! The ideal frequency response and weight information at the given frequency
         * node (it can be in the \f$\left[-1,1\right]\f$ interval,
         * and not the initial \f$\left[0,\pi\right]\f$, the difference is made with
@@ -108,6 +182,38 @@ namespace pm {
         void idealvals(T& D, T& W,
                 T const& xVal, std::vector<band_t<T>>& bands);
 
+        /*! The ideal frequency response and weight information at a set of
+        * frequency nodes. When the bands are ordered and do not overlap (which
+        * is the case for those used by the exchange algorithm) the band
+        * containing each node is found by binary search over the band edges.
+        * Nodes outside of all the bands get a zero response and weight.
+        * @param[out] D ideal frequency response at the nodes of xVal
+        * @param[out] W weight values at the nodes of xVal
+        * @param[in] xVal the frequency nodes where we do our computation
+        * @param[in] bands frequency band information for the ideal filter
+        */
+        template<typename T>
+        void idealvals(std::vector<T>& D, std::vector<T>& W,
+                std::vector<T> const& xVal, std::vector<band_t<T>>& bands);
+
+        /*! Same as the batch <tt>idealvals</tt> above, with the ordering of
+        * the bands given by the caller
+        * @param[in] sorted the value of <tt>bandsorted(bands)</tt>
+        */
+        template<typename T>
+        void idealvals(std::vector<T>& D, std::vector<T>& W,
+                std::vector<T> const& xVal, std::vector<band_t<T>>& bands,
+                bool sorted);
+
+        /*! Checks if the bands are ordered and do not overlap (adjacent bands
+        * are allowed to share an edge), in which case the band containing a
+        * node can be found by binary search
+        * @param[in] bands the frequency bands
+        * @return true if the bands are ordered
+        */
+        template<typename T>
+        bool bandsorted(std::vector<band_t<T>> const& bands);
+
 } // namespace pm
 
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+/**
+ * @file cache.h
+ * @brief Caching of the results of the Parks-McClellan routines
+ *
+ * A design is identified by a canonical form of its specification (see
+ * <tt>speckey</tt>), which holds everything that determines its result:
+ * the working type (and precision for MPFR designs), the filter order and
+ * type, the frequency bands with their amplitudes and weights, the
+ * initialization strategy, the convergence parameters and the options of
+ * <tt>pmopts_t</tt> that change the computed filter (the evaluation of the
+ * barycentric formulas with its FMM accuracy, and the precision ladder).
+ * The observer, cancellation flag and deadline are not part of it: they
+ * can only stop a design, and designs that did not succeed are not
+ * cached. Neither are designs given their own starting reference
+ * <tt>x0</tt>, since it may change the result within the convergence
+ * threshold: a key always maps to the design computed with the
+ * initialization strategy of its specification.
+ *
+ * Only the designs that <tt>pmspec_t</tt> can describe are covered:
+ * bands given by their band edges, amplitudes and weights. Designs of
+ * arbitrary bands (<tt>band_t</tt>) or of piecewise-linear bands
+ * (<tt>pwl_t</tt>) have no canonical form and are not cached.
+ */
+
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+#ifndef __PMCACHE_H__
+#define __PMCACHE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "pm.h"
+
+namespace pm {
+
+    /*! Canonical form of a filter specification, used as cache key. Two
+    * specifications give the same key if and only if they describe the
+    * same design (the values are written with enough digits to be told
+    * apart in the working precision).
+    * @param[in] spec the filter specification
+    * @return the key of the design
+    */
+    template<typename T>
+    std::string speckey(pmspec_t<T> const& spec);
+
+    /*! Key of the family of a design: designs of the same family only
+    * differ by the positions of their band edges, their amplitudes,
+    * weights, initialization strategy or convergence parameters, and the
+    * reference of one of them is a good starting point for the others.
+    * @param[in] spec the filter specification
+    * @return the key of the family of the design
+    */
+    template<typename T>
+    std::string familykey(pmspec_t<T> const& spec);
+
+    /*! 64-bit FNV-1a hash of a string
+    * @param[in] s the string to hash
+    * @return its hash
+    */
+    std::uint64_t fnv1a(std::string const& s);
+
+    /**
+     * @brief Persistent cache of filter designs.
+     *
+     * Every successful design is stored in a binary file of the cache
+     * directory, named after the hash of its key, which holds the key, the
+     * reference, the taps, delta, q, the iteration count and the status of
+     * the design. The reference is also saved as the latest one of the
+     * family of the design. A design that is not in the cache, but whose
+     * family is, is started from the reference of the family (see
+     * <tt>pmopts_t::x0</tt>) and usually converges in a couple of
+     * iterations. Such a warm-started design is returned, and its reference
+     * becomes that of the family, but it is not saved under its own key
+     * (see above).
+     *
+     * Files are written under a temporary name and renamed into place, so
+     * that any number of threads and processes can share a cache directory:
+     * readers see either a complete file or none. The files use the byte
+     * order and floating-point formats of the machine that wrote them.
+     * Failures to read or write the cache are not errors, they only turn
+     * into misses.
+     */
+    template<typename T>
+    class diskcache_t
+    {
+    public:
+        /*! @param[in] dir an existing directory in which the cache files
+        * are kept
+        */
+        explicit diskcache_t(std::string dir);
+
+        /*! Looks up a design in the cache
+        * @param[in] spec the filter specification
+        * @param[out] output the cached design, if there is one
+        * @return true for a cache hit
+        */
+        bool lookup(pmspec_t<T> const& spec, pmoutput_t<T>& output) const;
+
+        /*! Saves a design in the cache (designs that did not finish with
+        * STATUS_SUCCESS are ignored)
+        * @param[in] spec the filter specification
+        * @param[in] output the result of the design
+        */
+        void store(pmspec_t<T> const& spec, pmoutput_t<T> const& output) const;
+
+        /*! Looks up the latest reference saved for the family of a design
+        * @param[in] spec the filter specification
+        * @param[out] x the reference (in \f$[-1,1]\f$), if there is one
+        * @return true if a reference was found
+        */
+        bool nearest(pmspec_t<T> const& spec, std::vector<T>& x) const;
+
+        /*! The Parks-McClellan routine behind the cache: returns the cached
+        * design of spec, or computes it, starting from the reference of its
+        * family if the cache has one and spec does not give its own. Only
+        * the designs computed from the initialization strategy of spec are
+        * saved.
+        * @param[in] spec the filter specification
+        * @return the result of the design
+        */
+        pmoutput_t<T> firpm(pmspec_t<T> const& spec) const;
+
+    private:
+        std::string dir;        /**< cache directory */
+    };
+
+    /**
+     * @brief Counters of a design cache.
+     */
+    struct cachestats_t
+    {
+        std::uint64_t hits;         /**< requests (lookups and designs) found
+                                    in the cache */
+        std::uint64_t misses;       /**< requests not found in the cache (designs
+                                    that had to be computed and failed
+                                    lookups) */
+        std::uint64_t coalesced;    /**< requests that waited for the same
+                                    design computed by another thread (those
+                                    for which it did not succeed are then
+                                    designed again and also counted as
+                                    misses) */
+        std::uint64_t evictions;    /**< designs dropped to make room */
+        std::size_t entries;        /**< designs currently in the cache */
+        std::size_t bytes;          /**< estimated memory used by them */
+    };
+
+    /**
+     * @brief In-memory cache of filter designs, shared between threads.
+     *
+     * The designs are spread over shards by the hash of their key (see
+     * <tt>speckey</tt>), each shard having its own lock and its own least
+     * recently used list, so that threads working on different designs
+     * rarely wait for each other. The memory taken by the cached designs is
+     * bounded: each shard gets an equal part of the budget and drops its
+     * least recently used designs when it is exceeded.
+     *
+     * A design requested by several threads at the same time is only
+     * computed once: the first thread designs the filter while the others
+     * wait for its result. The waiting threads keep to their own deadline
+     * and cancellation flag, and only take over a result that finished
+     * with STATUS_SUCCESS: if the first thread was stopped by its own
+     * controls, or its design failed, each of them designs the filter
+     * itself. The observer of a request that receives the result of
+     * another thread is not called.
+     */
+    template<typename T>
+    class memcache_t
+    {
+    public:
+        /*! @param[in] maxbytes the memory budget of the cache
+        * @param[in] nshards the number of shards
+        */
+        explicit memcache_t(std::size_t maxbytes, std::size_t nshards = 16u);
+
+        /*! Looks up a design in the cache (counted as a hit or a miss)
+        * @param[in] spec the filter specification
+        * @param[out] output the cached design, if there is one
+        * @return true for a cache hit
+        */
+        bool lookup(pmspec_t<T> const& spec, pmoutput_t<T>& output);
+
+        /*! Saves a design in the cache (designs that did not finish with
+        * STATUS_SUCCESS are ignored)
+        * @param[in] spec the filter specification
+        * @param[in] output the result of the design
+        */
+        void store(pmspec_t<T> const& spec, pmoutput_t<T> const& output);
+
+        /*! The Parks-McClellan routine behind the cache: returns the cached
+        * design of spec, waits for it if another thread is computing it
+        * (computing it again if that thread does not succeed), or otherwise
+        * computes and saves it.
+        * @param[in] spec the filter specification
+        * @return the result of the design
+        */
+        pmoutput_t<T> firpm(pmspec_t<T> const& spec);
+
+        /*! @return the counters of the cache */
+        cachestats_t stats() const;
+
+        /*! Removes all the designs from the cache (the counters are kept) */
+        void clear();
+
+    private:
+        struct entry_t {
+            std::string key;
+            std::shared_ptr<pmoutput_t<T> const> output;
+            std::size_t bytes;
+        };
+
+        struct shard_t {
+            mutable std::mutex mutex;
+            std::list<entry_t> lru;     // most recently used first
+            std::unordered_map<std::string,
+                typename std::list<entry_t>::iterator> index;
+            std::unordered_map<std::string,
+                std::shared_future<pmoutput_t<T>>> pending;
+            std::size_t bytes{0u};
+        };
+
+        shard_t& shard(std::string const& key);
+        // inserts a design in a locked shard
+        void insert(shard_t& s, std::string const& key,
+                pmoutput_t<T> const& output);
+
+        std::size_t maxbytes;           /**< memory budget of each shard */
+        std::vector<std::unique_ptr<shard_t>> shards;
+        std::atomic<std::uint64_t> hits{0u};
+        std::atomic<std::uint64_t> misses{0u};
+        std::atomic<std::uint64_t> coalesced{0u};
+        std::atomic<std::uint64_t> evictions{0u};
+    };
+
+} // namespace pm
+
+#endif
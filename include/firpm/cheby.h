@@ -54,9 +54,40 @@ namespace pm {
         template<typename T>
         void equipts(std::vector<T>& v, std::size_t n);
 
+        /*! Maximal number of nodes kept in the cache of <tt>chebpts</tt>
+        * (over all the node sets of a given type) */
+        constexpr std::size_t CHEBPTS_CACHE_SIZE = 1u << 20;
+
+        /*! Returns the Chebyshev nodes of a given size and kind. The nodes are
+        * computed once for each (size, kind, precision) triple and then served
+        * from a thread-safe cache, so that repeated iterations and designs do
+        * not have to recompute the underlying cosines. When the cache holds
+        * more than <tt>CHEBPTS_CACHE_SIZE</tt> nodes, the least recently used
+        * sets are dropped from it
+        * @param[in] n the number of nodes
+        * @param[in] kind SECOND for the Chebyshev nodes of the second kind
+        * \f$\cos\left(\frac{i\pi}{n-1}\right)\f$ (i.e., the values of
+        * <tt>cos</tt> applied to the output of <tt>equipts</tt>), FIRST for the
+        * nodes of the first kind \f$\cos\left(\frac{(2i+1)\pi}{2n}\right)\f$,
+        * \f$0\leq i\leq n-1\f$
+        * @return the nodes, in decreasing order. For the MPFR type they are
+        * computed at the current default precision.
+        */
+        template<typename T>
+        std::shared_ptr<const std::vector<T>> chebpts(std::size_t n,
+                chebkind_t kind = SECOND);
+
+        /*! Releases the nodes stored in the <tt>chebpts</tt> cache. Callers
+        * still holding on to a set of nodes keep it valid.
+        */
+        template<typename T>
+        void chebptsclear();
+
 
         /*! This function computes the values of the coefficients of the CI when
-        * Chebyshev nodes of the second kind are used
+        * Chebyshev nodes of the second kind are used. Small sizes use Clenshaw
+        * sums at each node (\f$O(n^2)\f$ operations), while larger ones compute
+        * the equivalent DCT-I with an FFT (\f$O(n\log n)\f$ operations)
         * @param[out] c vector used to hold the values of the computed coefficients
         * @param[in] fv vector that holds the value of the current function to
         * approximate at the Chebyshev nodes of the second kind scaled to the
@@ -78,7 +109,10 @@ namespace pm {
                         std::vector<T>& c,
                         chebkind_t kind = SECOND);
 
-        /*! Chebyshev proxy rootfinding method for a given CI
+        /*! Chebyshev proxy rootfinding method for a given CI. The eigenvalues of
+        * the colleague matrix are computed from its (upper Hessenberg) transpose,
+        * without forming eigenvectors. CIs of large degree are first split into
+        * pieces of lower degree on subintervals of the domain.
         * @param[out] r the vector of computed roots of the CI
         * @param[in] c the Chebyshev coeffients of the polynomial whose roots
         * we want to find
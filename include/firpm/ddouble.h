@@ -0,0 +1,471 @@
+/**
+ * @file ddouble.h
+ * @brief Double-double arithmetic
+ *
+ * A <tt>ddouble</tt> represents a number as the unevaluated sum of two
+ * doubles \f$x_{hi} + x_{lo}\f$ with \f$|x_{lo}| \leq \frac{1}{2}
+ * \mathrm{ulp}(x_{hi})\f$, which gives a significand of about 106 bits
+ * (see [Dekker1971] and [Hida&Li&Bailey2001]). The basic operations rely
+ * on error-free transformations of the double precision sum and product,
+ * so that the type needs no heap storage and no global state: it sits
+ * between the x87 long double and the MPFR based mpfr::mpreal type, both
+ * in accuracy and in cost.
+ *
+ * The elementary functions have a relative accuracy of about \f$10^{-30}\f$
+ * for the arguments met by the exchange algorithm (they are not correctly
+ * rounded).
+ */
+
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+#ifndef __PMDDOUBLE_H__
+#define __PMDDOUBLE_H__
+
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <Eigen/Core>
+
+namespace pm {
+
+// the type and its functions live in their own namespace, where
+// argument-dependent lookup finds them, so that they do not hide the
+// standard math functions called unqualified from the rest of pm
+namespace dd {
+
+    /**
+     * @brief Double-double floating point number
+     */
+    struct ddouble
+    {
+        double hi;      /**< leading component */
+        double lo;      /**< trailing component */
+
+        ddouble() = default;
+        constexpr ddouble(double x) : hi(x), lo(0.0) {}
+        ddouble(long double x) : hi(static_cast<double>(x)),
+            lo(static_cast<double>(x - static_cast<long double>(hi))) {}
+        template<typename I, typename std::enable_if<
+            std::is_integral<I>::value, int>::type = 0>
+        ddouble(I x) : hi(static_cast<double>(x)),
+            lo(static_cast<double>(x - static_cast<I>(hi))) {}
+        /*! Builds the number from its two components, which must already
+         * be normalized. */
+        constexpr ddouble(double h, double l) : hi(h), lo(l) {}
+
+        explicit operator double() const { return hi; }
+        explicit operator long double() const
+        {
+            return static_cast<long double>(hi) + static_cast<long double>(lo);
+        }
+        /*! Truncates the number towards zero; hi alone can be an integer
+         * while hi + lo is just below (or above) it. */
+        explicit operator long() const
+        {
+            long h = static_cast<long>(hi);
+            double f = (hi - static_cast<double>(h)) + lo;
+            if(hi >= 0.0)
+                return f < 0.0 ? h - 1 : h;
+            return f > 0.0 ? h + 1 : h;
+        }
+
+        inline ddouble& operator+=(ddouble const& b);
+        inline ddouble& operator-=(ddouble const& b);
+        inline ddouble& operator*=(ddouble const& b);
+        inline ddouble& operator/=(ddouble const& b);
+    };
+
+    namespace ddimpl {
+
+        // s + e = a + b exactly, for |a| >= |b|
+        inline ddouble quicktwosum(double a, double b)
+        {
+            double s = a + b;
+            return ddouble(s, b - (s - a));
+        }
+
+        // s + e = a + b exactly
+        inline ddouble twosum(double a, double b)
+        {
+            double s = a + b;
+            double bb = s - a;
+            return ddouble(s, (a - (s - bb)) + (b - bb));
+        }
+
+        // p + e = a * b exactly
+        inline ddouble twoprod(double a, double b)
+        {
+            double p = a * b;
+#ifdef FP_FAST_FMA
+            return ddouble(p, std::fma(a, b, -p));
+#else
+            // Veltkamp splitting of the operands in two 26-bit halves
+            constexpr double splitter = 134217729.0;
+            double t = splitter * a;
+            double ah = t - (t - a), al = a - ah;
+            t = splitter * b;
+            double bh = t - (t - b), bl = b - bh;
+            return ddouble(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+#endif
+        }
+
+    } // namespace ddimpl
+
+    constexpr ddouble operator-(ddouble const& a) { return ddouble(-a.hi, -a.lo); }
+
+    inline ddouble operator+(ddouble const& a, ddouble const& b)
+    {
+        ddouble s = ddimpl::twosum(a.hi, b.hi);
+        ddouble t = ddimpl::twosum(a.lo, b.lo);
+        s.lo += t.hi;
+        s = ddimpl::quicktwosum(s.hi, s.lo);
+        s.lo += t.lo;
+        return ddimpl::quicktwosum(s.hi, s.lo);
+    }
+
+    inline ddouble operator-(ddouble const& a, ddouble const& b)
+    {
+        return a + (-b);
+    }
+
+    inline ddouble operator*(ddouble const& a, ddouble const& b)
+    {
+        ddouble p = ddimpl::twoprod(a.hi, b.hi);
+        p.lo += a.hi * b.lo + a.lo * b.hi;
+        return ddimpl::quicktwosum(p.hi, p.lo);
+    }
+
+    inline ddouble operator/(ddouble const& a, ddouble const& b)
+    {
+        // long division, with three partial quotients
+        double q1 = a.hi / b.hi;
+        ddouble r = a - ddouble(q1) * b;
+        double q2 = r.hi / b.hi;
+        r = r - ddouble(q2) * b;
+        double q3 = r.hi / b.hi;
+        ddouble q = ddimpl::quicktwosum(q1, q2);
+        return q + ddouble(q3);
+    }
+
+    inline ddouble& ddouble::operator+=(ddouble const& b) { return *this = *this + b; }
+    inline ddouble& ddouble::operator-=(ddouble const& b) { return *this = *this - b; }
+    inline ddouble& ddouble::operator*=(ddouble const& b) { return *this = *this * b; }
+    inline ddouble& ddouble::operator/=(ddouble const& b) { return *this = *this / b; }
+
+    inline bool operator==(ddouble const& a, ddouble const& b)
+    {
+        return a.hi == b.hi && a.lo == b.lo;
+    }
+    inline bool operator!=(ddouble const& a, ddouble const& b) { return !(a == b); }
+    inline bool operator<(ddouble const& a, ddouble const& b)
+    {
+        return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+    }
+    inline bool operator>(ddouble const& a, ddouble const& b) { return b < a; }
+    inline bool operator<=(ddouble const& a, ddouble const& b)
+    {
+        return a.hi < b.hi || (a.hi == b.hi && a.lo <= b.lo);
+    }
+    inline bool operator>=(ddouble const& a, ddouble const& b) { return b <= a; }
+
+    /* Free functions, found through argument-dependent lookup (by Eigen,
+     * among others) */
+    inline bool signbit(ddouble const& a) { return std::signbit(a.hi); }
+    inline bool isfinite(ddouble const& a) { return std::isfinite(a.hi); }
+    inline bool isnan(ddouble const& a) { return std::isnan(a.hi); }
+    inline bool isinf(ddouble const& a) { return std::isinf(a.hi); }
+
+    inline ddouble abs(ddouble const& a) { return a.hi < 0.0 ? -a : a; }
+    inline ddouble fabs(ddouble const& a) { return abs(a); }
+    inline ddouble fmax(ddouble const& a, ddouble const& b) { return a < b ? b : a; }
+    inline ddouble fmin(ddouble const& a, ddouble const& b) { return b < a ? b : a; }
+
+    inline ddouble ldexp(ddouble const& a, int e)
+    {
+        return ddouble(std::ldexp(a.hi, e), std::ldexp(a.lo, e));
+    }
+
+    inline ddouble frexp(ddouble const& a, int* e)
+    {
+        double m = std::frexp(a.hi, e);
+        return ddouble(m, std::ldexp(a.lo, -*e));
+    }
+
+    inline ddouble floor(ddouble const& a)
+    {
+        double h = std::floor(a.hi);
+        if(h != a.hi)
+            return ddouble(h);
+        return ddimpl::quicktwosum(h, std::floor(a.lo));
+    }
+
+    inline ddouble sqrt(ddouble const& a)
+    {
+        if(a.hi <= 0.0)
+            return ddouble(std::sqrt(a.hi));
+        // one Newton step from the double precision value
+        double x = 1.0 / std::sqrt(a.hi);
+        double ax = a.hi * x;
+        ddouble r = a - ddimpl::twoprod(ax, ax);
+        return ddimpl::twosum(ax, r.hi * (x * 0.5));
+    }
+
+    namespace ddimpl {
+        constexpr ddouble pi{3.141592653589793116e+00, 1.224646799147353207e-16};
+        constexpr ddouble pi2{1.570796326794896558e+00, 6.123233995736766036e-17};
+        constexpr ddouble ln2{6.931471805599452862e-01, 2.319046813846299558e-17};
+        constexpr double eps = 4.93038065763132e-32;    // 2^-104
+
+        // Taylor series of sin and cos for |r| <= pi/4
+        inline void sincos(ddouble const& r, ddouble& s, ddouble& c)
+        {
+            ddouble r2 = r * r;
+            ddouble term = r;
+            s = r;
+            for(int k = 2; std::fabs(term.hi) > eps * std::fabs(s.hi); k += 2) {
+                term = -term * r2 / ddouble(k * (k + 1));
+                s += term;
+            }
+            term = 1.0;
+            c = 1.0;
+            for(int k = 1; std::fabs(term.hi) > eps; k += 2) {
+                term = -term * r2 / ddouble(k * (k + 1));
+                c += term;
+            }
+        }
+
+        // reduces a modulo pi/2 and returns the quadrant of the argument
+        inline int reduce(ddouble const& a, ddouble& r)
+        {
+            ddouble q = floor(a / pi2 + ddouble(0.5));
+            r = a - q * pi2;
+            return static_cast<int>(std::fmod(q.hi, 4.0) + (q.hi < 0.0 ? 4.0 : 0.0)) & 3;
+        }
+    } // namespace ddimpl
+
+    inline ddouble sin(ddouble const& a)
+    {
+        ddouble r, s, c;
+        int q = ddimpl::reduce(a, r);
+        ddimpl::sincos(r, s, c);
+        switch(q) {
+            case 0: return s;
+            case 1: return c;
+            case 2: return -s;
+            default: return -c;
+        }
+    }
+
+    inline ddouble cos(ddouble const& a)
+    {
+        ddouble r, s, c;
+        int q = ddimpl::reduce(a, r);
+        ddimpl::sincos(r, s, c);
+        switch(q) {
+            case 0: return c;
+            case 1: return -s;
+            case 2: return -c;
+            default: return s;
+        }
+    }
+
+    inline ddouble tan(ddouble const& a) { return sin(a) / cos(a); }
+
+    inline ddouble exp(ddouble const& a)
+    {
+        if(a.hi > 709.0)
+            return ddouble(std::numeric_limits<double>::infinity());
+        if(a.hi < -745.0)
+            return ddouble(0.0);
+        // a = k log(2) + 2^10 r, with exp(2^10 r) obtained by squaring
+        // exp(r) - 1 ten times
+        double k = std::floor(a.hi / ddimpl::ln2.hi + 0.5);
+        ddouble r = ldexp(a - ddouble(k) * ddimpl::ln2, -10);
+        ddouble term = r, s = r;
+        for(int i = 2; std::fabs(term.hi) > ddimpl::eps * std::fabs(s.hi); ++i) {
+            term = term * r / ddouble(i);
+            s += term;
+        }
+        for(int i = 0; i < 10; ++i)
+            s = ldexp(s, 1) + s * s;
+        return ldexp(s + ddouble(1.0), static_cast<int>(k));
+    }
+
+    inline ddouble log(ddouble const& a)
+    {
+        if(a.hi <= 0.0 || !std::isfinite(a.hi))
+            return ddouble(std::log(a.hi));
+        // one Newton step for exp(x) = a
+        ddouble x = std::log(a.hi);
+        return x + a * exp(-x) - ddouble(1.0);
+    }
+
+    inline ddouble pow(ddouble const& a, ddouble const& b)
+    {
+        if(a.hi == 0.0)
+            return ddouble(std::pow(0.0, b.hi));
+        return exp(b * log(a));
+    }
+
+    inline ddouble atan(ddouble const& a)
+    {
+        if(!std::isfinite(a.hi))
+            return ddouble(std::atan(a.hi));
+        // one Newton step for sin(z) - a cos(z) = 0
+        ddouble z = std::atan(a.hi);
+        ddouble s = sin(z), c = cos(z);
+        return z - (s - a * c) / (c + a * s);
+    }
+
+    inline ddouble asin(ddouble const& a)
+    {
+        ddouble one = 1.0;
+        if(abs(a) >= one)
+            return a.hi < 0.0 ? -ddimpl::pi2 : ddimpl::pi2;
+        return atan(a / sqrt((one - a) * (one + a)));
+    }
+
+    inline ddouble acos(ddouble const& a)
+    {
+        // half-angle form, acos(a) = 2 atan(sqrt((1 - a)(1 + a)) / (1 + a)),
+        // which keeps its relative accuracy near 1 and -1 (pi/2 - asin(a)
+        // cancels there)
+        ddouble one = 1.0;
+        if(abs(a) >= one)
+            return a.hi < 0.0 ? ddimpl::pi : ddouble(0.0);
+        ddouble ap1 = one + a;
+        return ldexp(atan(sqrt((one - a) * ap1) / ap1), 1);
+    }
+
+    /*! Writes the number in scientific notation. As for the built-in types,
+     * the precision of the stream is the number of significant digits, or the
+     * number of digits after the decimal point with std::scientific. */
+    inline std::ostream& operator<<(std::ostream& os, ddouble const& a)
+    {
+        if(!std::isfinite(a.hi) || a.hi == 0.0)
+            return os << a.hi;
+        std::streamsize digits = os.precision() > 0 ? os.precision() : 6;
+        if((os.flags() & std::ios_base::floatfield) != std::ios_base::scientific)
+            --digits;
+        digits = std::min<std::streamsize>(digits, 32);
+        ddouble x = abs(a);
+        int e10 = static_cast<int>(std::floor(std::log10(x.hi)));
+        // scale to [1, 10) by binary powering of ten
+        ddouble p = 1.0, ten = 10.0;
+        for(int k = std::abs(e10); k > 0; k >>= 1, ten *= ten)
+            if(k & 1)
+                p *= ten;
+        x = e10 < 0 ? x * p : x / p;
+        if(x.hi >= 10.0) {
+            x /= ddouble(10.0);
+            ++e10;
+        } else if(x.hi < 1.0) {
+            x *= ddouble(10.0);
+            --e10;
+        }
+        std::string m;
+        for(std::streamsize i = 0; i <= digits + 1; ++i) {
+            int d = std::min(9, std::max(0, static_cast<int>(floor(x).hi)));
+            m.push_back(static_cast<char>('0' + d));
+            x = (x - ddouble(d)) * ddouble(10.0);
+        }
+        // round the last digit away
+        bool up = m.back() >= '5';
+        m.pop_back();
+        for(std::size_t i = m.size(); up && i-- > 0u; ) {
+            up = (m[i] == '9');
+            m[i] = up ? '0' : static_cast<char>(m[i] + 1);
+        }
+        if(up) {
+            m.insert(m.begin(), '1');
+            m.pop_back();
+            ++e10;
+        }
+        std::ostringstream out;
+        if(a.hi < 0.0)
+            out << '-';
+        out << m[0];
+        if(m.size() > 1u)
+            out << '.' << m.substr(1);
+        out << 'e' << (e10 < 0 ? '-' : '+') << (std::abs(e10) < 10 ? "0" : "")
+            << std::abs(e10);
+        return os << out.str();
+    }
+
+} // namespace dd
+
+    using dd::ddouble;
+
+} // namespace pm
+
+namespace std {
+    template<>
+    class numeric_limits<pm::ddouble> : public numeric_limits<double>
+    {
+    public:
+        static constexpr int digits = 106;
+        static constexpr int digits10 = 31;
+        static constexpr int max_digits10 = 33;
+        static constexpr pm::ddouble min() noexcept
+        {
+            // the trailing component must stay normalized
+            return pm::ddouble(2.004168360008972777e-292);
+        }
+        static constexpr pm::ddouble max() noexcept
+        {
+            return pm::ddouble(1.79769313486231570815e+308, 9.97920154767359795037e+291);
+        }
+        static constexpr pm::ddouble lowest() noexcept { return -max(); }
+        static constexpr pm::ddouble epsilon() noexcept { return pm::dd::ddimpl::eps; }
+        static constexpr pm::ddouble round_error() noexcept { return 0.5; }
+        static constexpr pm::ddouble infinity() noexcept
+        {
+            return numeric_limits<double>::infinity();
+        }
+        static constexpr pm::ddouble quiet_NaN() noexcept
+        {
+            return numeric_limits<double>::quiet_NaN();
+        }
+        static constexpr pm::ddouble signaling_NaN() noexcept
+        {
+            return numeric_limits<double>::signaling_NaN();
+        }
+        static constexpr pm::ddouble denorm_min() noexcept
+        {
+            return numeric_limits<double>::denorm_min();
+        }
+    };
+} // namespace std
+
+namespace Eigen {
+    template<>
+    struct NumTraits<pm::ddouble> : GenericNumTraits<pm::ddouble>
+    {
+        typedef pm::ddouble Real;
+        typedef pm::ddouble NonInteger;
+        typedef pm::ddouble Nested;
+        typedef pm::ddouble Literal;
+
+        enum {
+            IsInteger = 0,
+            IsSigned = 1,
+            IsComplex = 0,
+            RequireInitialization = 0,
+            ReadCost = 2,
+            AddCost = 20,
+            MulCost = 20
+        };
+
+        static inline Real epsilon() { return std::numeric_limits<pm::ddouble>::epsilon(); }
+        static inline Real dummy_precision() { return 1e-28; }
+        static inline Real highest() { return std::numeric_limits<pm::ddouble>::max(); }
+        static inline Real lowest() { return std::numeric_limits<pm::ddouble>::lowest(); }
+        static inline int digits10() { return std::numeric_limits<pm::ddouble>::digits10; }
+    };
+} // namespace Eigen
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file fmm.h
+ * @brief Hierarchical (tree code) evaluation of the barycentric formulas,
+ * used by the exchange algorithm for very long filters
+ *
+ * The reference set is stored in a binary tree whose nodes carry
+ * Chebyshev proxies: the interpolation nodes of a node that is far enough
+ * from an evaluation point are replaced by \f$p\f$ charges located at the
+ * Chebyshev points of its interval (see [Dutt&Gu&Rokhlin1996] and
+ * [Fong&Darve2009] for the underlying ideas). The barycentric weights and
+ * the values of the interpolant at \f$m\f$ points are then obtained in
+ * \f$O((n + m)\,p\log n)\f$ operations, instead of the \f$O(n^2)\f$ and
+ * \f$O(mn)\f$ of the direct formulas.
+ */
+
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+#ifndef __PMFMM_H__
+#define __PMFMM_H__
+
+#include "util.h"
+#include "band.h"
+
+namespace pm {
+
+        /**
+         * @brief A node of the tree used by the fast barycentric routines.
+         */
+        template<typename T>
+        struct fmmnode_t
+        {
+                std::size_t first;      /**< index of its first interpolation node */
+                std::size_t last;       /**< one past the index of its last node */
+                std::size_t child;      /**< index of its first child (the second
+                                        one follows it), 0 for a leaf */
+                T c;                    /**< center of the interval spanned by its nodes */
+                T r;                    /**< half-width of that interval */
+        };
+
+        /**
+         * @brief Hierarchical representation of a reference set (and of the
+         * data interpolated on it) used by the fast barycentric routines.
+         *
+         * The storage is kept between calls, so that rebuilding the tree for
+         * a new reference of the same size does not allocate.
+         */
+        template<typename T>
+        struct barytree_t
+        {
+                std::size_t p = 0u;             /**< number of proxies per node */
+                T mac;                          /**< a node is treated through its proxies
+                                                at points further away from its center
+                                                than mac times its half-width */
+                std::vector<T> u;               /**< Chebyshev points of the first kind */
+                std::vector<T> lambda;          /**< their barycentric weights */
+                std::vector<T> y;               /**< interpolation nodes in increasing order */
+                std::vector<std::size_t> idx;   /**< position of each of them in the reference */
+                std::vector<T> f;               /**< interpolated values (sorted order) */
+                std::vector<T> wy;              /**< barycentric weights (sorted order) */
+                std::vector<fmmnode_t<T>> nodes;/**< the nodes of the tree (the root first,
+                                                children after their parents) */
+                std::vector<T> yp;              /**< proxy locations, p per tree node */
+                std::vector<T> Qf;              /**< proxy charges of the w*f sums */
+                std::vector<T> Qw;              /**< proxy charges of the w sums */
+                std::vector<T> Q1;              /**< proxy charges for unit charges */
+                std::vector<T> q;               /**< scratch space for the node charges */
+        };
+
+        /*! Builds the tree associated to a reference set. The number of proxies
+        * is chosen so that the far field contributions are approximated with a
+        * relative accuracy of about tol.
+        * @param[out] tree the tree to (re)build
+        * @param[in] x the reference set (the nodes need not be sorted)
+        * @param[in] tol the requested accuracy (0 for the working precision of T)
+        */
+        template<typename T>
+        void fmminit(barytree_t<T>& tree, std::vector<T> const& x,
+                double tol = 0.0);
+
+        /*! Computes the barycentric weights of the reference set stored in the
+        * tree. They are normalized in the same way as those of
+        * <tt>baryweights</tt>.
+        * @param[out] w the computed weights (in the order of the reference used
+        * to build the tree)
+        * @param[in,out] tree the tree built for the reference (the weights are
+        * also stored inside it)
+        */
+        template<typename T>
+        void fmmweights(std::vector<T>& w, barytree_t<T>& tree);
+
+        /*! Sets the values to interpolate at the nodes of the tree and computes
+        * the corresponding proxy charges. The barycentric weights must have been
+        * computed beforehand with <tt>fmmweights</tt>.
+        * @param[in,out] tree the tree built for the reference
+        * @param[in] C the values at the reference (in the order of the reference
+        * used to build the tree)
+        */
+        template<typename T>
+        void fmmcharges(barytree_t<T>& tree, std::vector<T> const& C);
+
+        /*! Computes the frequency response of the current filter at a set of
+        * nodes, using the tree representation of the interpolant (see the batch
+        * version of <tt>approx</tt> in barycentric.h)
+        * @param[out] Pc the frequency response amplitude values at the nodes of
+        * xVal
+        * @param[in] xVal the frequency nodes where we do our computation
+        * (the points are given in the \f$\left[-1,1\right]\f$ interval)
+        * @param[in] tree the tree representation of the interpolant
+        */
+        template<typename T>
+        void approx(std::vector<T>& Pc, std::vector<T> const& xVal,
+                barytree_t<T> const& tree);
+
+        /*! Computes the approximation error at a set of nodes, using the tree
+        * representation of the interpolant (see the batch version of
+        * <tt>comperror</tt> in barycentric.h)
+        * @param[out] error the error values at the nodes of xVal
+        * @param[in] xVal the frequency nodes where we do our computation
+        * @param[in] delta the current reference error
+        * @param[in] tree the tree representation of the interpolant
+        * @param[in] bands frequency band information for the ideal filter
+        */
+        template<typename T>
+        void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+                T const& delta, barytree_t<T> const& tree,
+                std::vector<band_t<T>>& bands);
+
+        /*! Same as the <tt>comperror</tt> above, with the ordering of the
+        * bands given by the caller
+        * @param[in] sorted the value of <tt>bandsorted(bands)</tt>
+        */
+        template<typename T>
+        void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+                T const& delta, barytree_t<T> const& tree,
+                std::vector<band_t<T>>& bands, bool sorted);
+
+} // namespace pm
+
+#endif
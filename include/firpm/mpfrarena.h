@@ -0,0 +1,77 @@
+/**
+ * @file mpfrarena.h
+ * @brief Scratch storage for the MPFR kernels of the library
+ *
+ * Every temporary <tt>mpfr::mpreal</tt> costs an <tt>mpfr_init2</tt>/
+ * <tt>mpfr_clear</tt> pair and a heap allocation. The kernels that run the
+ * innermost loops of the exchange algorithm with the MPFR type work instead
+ * on raw <tt>mpfr_t</tt> numbers whose significands are placed in one
+ * contiguous buffer through MPFR's custom interface, and update them in
+ * place.
+ */
+
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+#ifndef __PMMPFRARENA_H__
+#define __PMMPFRARENA_H__
+
+#ifdef HAVE_MPFR
+
+#include <vector>
+#include "mpreal.h"
+
+namespace pm {
+
+    /**
+     * @brief Contiguous storage for a set of MPFR temporaries
+     *
+     * The storage only grows, so that after the first calls a kernel gets
+     * its temporaries without any allocation. The numbers must not be
+     * passed to <tt>mpfr_clear</tt> or <tt>mpfr_set_prec</tt>.
+     */
+    class mpfrarena_t
+    {
+    public:
+        /*! Provides n consecutive numbers of precision prec, all set to zero.
+        * The numbers returned by a previous call are invalidated.
+        * @param[in] n the number of temporaries
+        * @param[in] prec their precision
+        * @return a pointer to the first of them
+        */
+        mpfr_ptr reserve(std::size_t n, mpfr_prec_t prec)
+        {
+            std::size_t nl = (mpfr_custom_get_size(prec) + sizeof(mp_limb_t) - 1u)
+                / sizeof(mp_limb_t);
+            if(limbs.size() < n * nl)
+                limbs.resize(n * nl);
+            if(nums.size() < n)
+                nums.resize(n);
+            for(std::size_t i{0u}; i < n; ++i) {
+                void* significand = limbs.data() + i * nl;
+                mpfr_custom_init(significand, prec);
+                mpfr_custom_init_set(&nums[i], MPFR_ZERO_KIND, 0, prec, significand);
+            }
+            return nums.data();
+        }
+
+    private:
+        std::vector<mp_limb_t> limbs;   /**< significands of the numbers */
+        std::vector<__mpfr_struct> nums;/**< the numbers themselves */
+    };
+
+    /*! The arena of the calling thread (the kernels run on the worker
+    * threads of the exchange algorithm, each of them reuses its own storage
+    * from one call to the next)
+    */
+    inline mpfrarena_t& mpfrarena()
+    {
+        static thread_local mpfrarena_t arena;
+        return arena;
+    }
+
+} // namespace pm
+
+#endif
+
+#endif
@@ -13,6 +13,9 @@
 #ifndef __PMPM_H__
 #define __PMPM_H__
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include "util.h"
 #include "cheby.h"
 #include "barycentric.h"
@@ -38,6 +41,14 @@ namespace pm {
         AFP                     /**< AFP algorithm-based initialization */
     };
 
+    /** Value of the nmax parameter of the Parks-McClellan routines which
+     * selects an adaptive degree for the CPR method: the interpolant on each
+     * subinterval is refined until its Chebyshev coefficients become
+     * negligible, and an iteration that does not find enough alternating
+     * extrema is redone with denser interpolants.
+     */
+    constexpr std::size_t NMAX_ADAPTIVE = 0u;
+
     /** @enum status_t code to distinguish the
      * various states in which the Parks-McClellan
      * algorithm execution finished in. */
@@ -54,7 +65,113 @@ namespace pm {
         STATUS_COEFFICIENT_SET_INVALID,     /**< invalid final coefficient set */
         STATUS_EXCHANGE_FAILURE,            /**< runtime error in producing a valid reference set */
         STATUS_CONVERGENCE_WARNING,         /**< successful execution, but with convengence warnings */
-        STATUS_UNKNOWN_FAILURE              /**< unknown runtime failure */
+        STATUS_UNKNOWN_FAILURE,             /**< unknown runtime failure */
+        STATUS_INTERRUPTED,                 /**< cancelled or past the deadline, the output holds
+                                            the filter of the best reference found until then */
+        STATUS_ORDER_LIMIT                  /**< no filter order up to the search limit
+                                            meets the given deviations */
+    };
+
+    /** @enum bary_t flag selecting how the barycentric
+     * formulas are evaluated during the exchange algorithm
+     */
+    enum class bary_t {
+        DIRECT,                 /**< direct summation over the reference set */
+        FMM,                    /**< hierarchical evaluation with Chebyshev proxies
+                                (see fmm.h), in about \f$O(n\log n)\f$ operations
+                                per iteration instead of \f$O(n^2)\f$ */
+        AUTO                    /**< FMM for double, long double, double-double
+                                and quadruple precision designs with large
+                                reference sets, DIRECT otherwise (MPFR and
+                                octuple precision designs) */
+    };
+
+    /**
+     * @brief State of the exchange algorithm at the end of an iteration.
+     *
+     * Handed over to the observer of <tt>pmopts_t</tt>. The values are given
+     * in double precision whatever the working type of the design, so that
+     * the same observer also follows the lower precision runs of the
+     * precision ladder.
+     */
+    struct pmprogress_t
+    {
+        std::size_t iter;           /**< iteration number (from 1, for each run of
+                                    the exchange algorithm) */
+        double q;                   /**< convergence parameter value */
+        double delta;               /**< current reference error */
+        std::size_t refsize;        /**< size of the reference set */
+        std::vector<std::size_t> bandcount;
+                                    /**< number of reference points in each
+                                    frequency band */
+        bool cycle;                 /**< cycling was detected and the reference
+                                    update rule is changed for the next iteration */
+        bool rung;                  /**< the iteration is part of a lower precision
+                                    run of the precision ladder */
+        double elapsed;             /**< seconds elapsed since the call to
+                                    <tt>exchange</tt> */
+    };
+
+    /**
+     * @brief Additional controls of the Parks-McClellan routines.
+     *
+     * An object of this type is the optional last argument of <tt>exchange</tt>
+     * and of the <tt>firpm</tt> routines. The default values give the behavior
+     * of these routines without it.
+     *
+     * The cancellation flag and the deadline are checked before each iteration
+     * of the exchange algorithm and between the subintervals it processes. An
+     * interrupted design returns, with STATUS_INTERRUPTED, the filter of the
+     * reference with the smallest convergence parameter found so far (the
+     * starting reference if no iteration was completed).
+     */
+    template<typename T>
+    struct pmopts_t
+    {
+        bary_t bary = bary_t::DIRECT;
+                                    /**< evaluation of the barycentric formulas
+                                    (FMM and AUTO trade the exact sums for the
+                                    accuracy of the FMM, see fmmtol) */
+        double fmmtol = 0.0;        /**< accuracy requested from the FMM evaluation
+                                    (0 for the working precision of T) */
+        bool ladder = false;        /**< for long double, double-double, quadruple,
+                                    octuple and MPFR designs, iterate in the lower
+                                    precisions (double, long double, double-double)
+                                    until the convergence stagnates and only finish
+                                    in T; if the lower precision runs fail, the
+                                    design is redone in T from the initial
+                                    reference */
+        std::function<bool(pmprogress_t const&)> observer;
+                                    /**< if set, called on the thread running the
+                                    design after each iteration of the exchange
+                                    algorithm (the <tt>firpm</tt> routines may run
+                                    it several times, e.g. once per reference
+                                    scaling level; for the designs that
+                                    <tt>firpm_batch</tt>, <tt>firpm_sweep</tt> and
+                                    <tt>firpmord</tt> run in parallel, that is a
+                                    worker thread, and the calls of all their
+                                    observers are made one at a time);
+                                    returning false stops the iterations, the
+                                    filter is then computed from the current
+                                    reference and the status is
+                                    STATUS_CONVERGENCE_WARNING unless it already
+                                    satisfies the convergence threshold */
+        std::atomic<bool> const* cancel = nullptr;
+                                    /**< if set, a flag that another thread can raise
+                                    (and must not lower again) to cancel the design */
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::time_point::max();
+                                    /**< time past which the design is interrupted */
+        std::vector<T> x0;          /**< if not empty, the starting reference of the
+                                    exchange algorithm (e.g. the x member of the
+                                    output of a previous design), used instead of
+                                    the initialization strategy; its points are
+                                    moved into the nearest band and, if there are
+                                    not as many as the design needs, redistributed
+                                    between the bands by interpolation */
+        space_t x0space = space_t::CHEBY;
+                                    /**< space of the points of x0 (\f$[-1,1]\f$
+                                    for CHEBY, \f$[0,\pi]\f$ for FREQ) */
     };
 
     /**
@@ -77,6 +194,37 @@ namespace pm {
         status_t status;            /**< status code for the output object */
     };
 
+    /**
+     * @brief Description of a single filter design request.
+     *
+     * Bundles the arguments of the <tt>firpm</tt> routines so that several
+     * designs can be handed over at once (see <tt>firpm_batch</tt>). The
+     * default values match those of <tt>firpm</tt>.
+     */
+    template<typename T>
+    struct pmspec_t
+    {
+        std::size_t n;              /**< filter order (\f$n+1\f$ coefficients) */
+        std::vector<T> f;           /**< frequency ranges of each band of interest */
+        std::vector<T> a;           /**< ideal amplitude at each point of f */
+        std::vector<T> w;           /**< weight function value on each band */
+        bool antisym = false;       /**< if true, design a type III or IV filter
+                                    of the given type, otherwise a type I or II filter */
+        filter_t type = filter_t::FIR_DIFFERENTIATOR;
+                                    /**< type of antisymmetric filter (only used if
+                                    antisym is set) */
+        double eps = 0.01;          /**< convergence parameter threshold */
+        std::size_t nmax = 4u;      /**< degree used by the CPR method on each subinterval
+                                    (NMAX_ADAPTIVE for an adaptive degree) */
+        init_t strategy = init_t::UNIFORM;
+                                    /**< initialization strategy */
+        std::size_t depth = 0u;     /**< number of reference scaling levels */
+        init_t rstrategy = init_t::UNIFORM;
+                                    /**< initialization strategy at the lowest scaling level */
+        unsigned long prec = 165ul; /**< numerical precision of the MPFR type */
+        pmopts_t<T> opts;           /**< additional controls */
+    };
+
     /*! An implementation of the uniform initialization approach for
     * starting the Parks-McClellan algorithm
     * @param[out] omega the initial set of references to be computed
@@ -126,8 +274,10 @@ namespace pm {
     * significant digits of the minimax error that are accurate at the end of the 
     * final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last 
     * iteration. Since there is no explicit filter type (I to IV) given as input, 
     * the h vector of the output will correspond to the coefficients of the frequency 
@@ -178,7 +328,8 @@ namespace pm {
             std::vector<band_t<T>>& cbands,
             double eps = 0.01,
             std::size_t nmax = 4u, 
-            unsigned long prec = 165ul);
+            unsigned long prec = 165ul,
+            pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type I and II FIR filters.
     * This routine is the most general and can be set to use any of the three
@@ -194,6 +345,7 @@ namespace pm {
     * of significant digits of the minimax error that are accurate at the end of 
     * the final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] strategy initialization strategy. Can be UNIFORM, SCALING or AFP
     * @param[in] depth in case the SCALING initialization strategy is used, 
     * specifies the number of scaling levels to use (by default, the value is set
@@ -204,6 +356,7 @@ namespace pm {
     * default)
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last 
     * iteration. The h vector of the output contains the coefficients corresponding 
     * to the transfer function of the final filter (in this case, for types I and II,
@@ -230,7 +383,8 @@ namespace pm {
                 init_t strategy = init_t::UNIFORM,
                 std::size_t depth = 0u,
                 init_t rstrategy = init_t::UNIFORM,
-                unsigned long prec = 165ul);
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type I and II FIR filters,
     * accepting pre-built band specifications with arbitrary callable amplitude
@@ -238,17 +392,21 @@ namespace pm {
     * firpm(n, f, a, w) overload constructs bands and delegates here.  Callers
     * supply one band_t<T> per band with amplitude and weight expressing the true
     * desired frequency response; the cos(omega/2) basis change for type II is
-    * applied internally.
+    * applied internally.  Bands set up with pwlinit (piecewise-linear amplitude,
+    * constant weight) are evaluated natively, without going through the
+    * callables.
     * @param[in] n filter order; n+1 coefficients are returned.  Even n gives
     *   type I, odd n gives type II.
     * @param[in] fbands frequency-space band specifications (space_t::FREQ)
     * @param[in] eps convergence threshold
-    * @param[in] nmax CPR degree per subinterval
+    * @param[in] nmax CPR degree per subinterval (NMAX_ADAPTIVE for an adaptive
+    *   degree)
     * @param[in] strategy initialization strategy: UNIFORM, SCALING, or AFP
     * @param[in] depth scaling levels (used when strategy is SCALING)
     * @param[in] rstrategy initialization strategy for the smallest-order filter
     *   when SCALING is used
     * @param[in] prec MPFR precision in bits (ignored for double/long double)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return pmoutput_t with h containing the full n+1 tap vector
     */
     template<typename T>
@@ -259,7 +417,8 @@ namespace pm {
                 init_t strategy = init_t::UNIFORM,
                 std::size_t depth = 0u,
                 init_t rstrategy = init_t::UNIFORM,
-                unsigned long prec = 165ul);
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type I and II FIR filters. This routine uses 
     * reference scaling by default and is just a wrapper over the <tt>firpm</tt>.
@@ -272,12 +431,14 @@ namespace pm {
     * significant digits of the minimax error that are accurate at the end of the 
     * final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] depth how many times should reference scaling be applied 
     * recursively (default value is 1)
     * @param[in] rstrategy  what initialization strategy to use at the lowest level 
     * (uniform or AFP-based) if strategy is reference scaling 
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last iteration. 
     * The h vector of the output contains the coefficients corresponding to the transfer 
     * function of the final filter (in this case, for types I and II, the values are 
@@ -293,7 +454,8 @@ namespace pm {
                 std::size_t nmax = 4u,
                 std::size_t depth = 1u,
                 init_t rstrategy = init_t::UNIFORM,
-                unsigned long prec = 165ul);
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type I and II FIR filters. This routine 
     * uses AFP-based initialization and is just a wrapper over <tt>firpm</tt>.
@@ -306,8 +468,10 @@ namespace pm {
     * significant digits of the minimax error that are accurate at the end of the 
     * final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last iteration. 
     * The h vector of the output contains the coefficients corresponding to the transfer 
     * function of the final filter (in this case, for types I and II, the values are 
@@ -321,7 +485,8 @@ namespace pm {
                 std::vector<T>const& w,
                 double eps = 0.01,
                 std::size_t nmax = 4u,
-                unsigned long prec = 165ul);
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type III and IV FIR filters. 
     * This routine is the most general and can be set to use any of the three
@@ -339,6 +504,7 @@ namespace pm {
     * of significant digits of the minimax error that are accurate at the end of 
     * the final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] strategy the initialization strategy
     * @param[in] depth how many times should reference scaling be applied 
     * recursively (default value is 1)
@@ -346,6 +512,7 @@ namespace pm {
     * (uniform or AFP-based) if strategy is reference scaling 
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last iteration. 
     * The h vector of the output contains the coefficients corresponding to the 
     * transfer function of the final filter (in this case, for types III and IV, 
@@ -362,7 +529,8 @@ namespace pm {
             init_t strategy = init_t::UNIFORM,
             std::size_t depth = 0u,
             init_t rstrategy = init_t::UNIFORM,
-            unsigned long prec = 165ul);
+            unsigned long prec = 165ul,
+            pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type III and IV FIR filters. 
     * This routine uses reference scaling.
@@ -378,12 +546,14 @@ namespace pm {
     * number of significant digits of the minimax error that are accurate 
     * at the end of the final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] depth how many times should reference scaling be applied 
     * recursively (default value is 1)
     * @param[in] rstrategy  what initialization strategy to use at the 
     * lowest level (uniform or AFP-based)
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last 
     * iteration. The h vector of the output contains the coefficients corresponding 
     * to the transfer function of the final filter (in this case, for types III and 
@@ -399,7 +569,8 @@ namespace pm {
                 std::size_t nmax = 4u,
                 std::size_t depth = 1u,
                 init_t rstrategy = init_t::UNIFORM,
-                unsigned long prec = 165ul);
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
 
     /*! Parks-McClellan routine for implementing type III and IV FIR filters.
     * This routine uses AFP-based initialization.
@@ -415,8 +586,10 @@ namespace pm {
     * of significant digits of the minimax error that are accurate at the end 
     * of the final iteration)
     * @param[in] nmax the degree used by the CPR method on each subinterval
+    * (NMAX_ADAPTIVE selects it adaptively on each subinterval)
     * @param[in] prec the numerical precision of the MPFR type (will be disregarded for
     * the double and long double instantiations of the functions)
+    * @param[in] opts additional controls (see pmopts_t)
     * @return information pertaining to the polynomial computed at the last 
     * iteration. The h vector of the output contains the coefficients corresponding 
     * to the transfer function of the final filter (in this case, for types III and 
@@ -430,7 +603,143 @@ namespace pm {
                 filter_t type,
                 double eps = 0.01,
                 std::size_t nmax = 4u,
-                unsigned long prec = 165ul);
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
+
+    /*! Parks-McClellan routine for a filter given by its specification:
+    * calls the <tt>firpm</tt> overload matching the symmetry of the filter.
+    * @param[in] spec the filter specification
+    * @return the output of the Parks-McClellan algorithm
+    */
+    template<typename T>
+    pmoutput_t<T> firpmspec(pmspec_t<T> const& spec);
+
+    /*! Designs a set of independent filters, distributing the work over the
+    * available cores. Designs of order smaller than <tt>nsplit</tt> are run
+    * concurrently, one design per thread, with the longest ones scheduled
+    * first. Designs of order at least <tt>nsplit</tt> are run one after the
+    * other, each of them parallelizing its own extrema search over all the
+    * threads. For the MPFR type, each design is computed with its own
+    * precision (see pmspec_t::prec), set once per thread that works on it,
+    * so that a batch can mix designs of different precisions. The observers
+    * of the designs are called from the threads running them, one call at
+    * a time, so that the designs can share one.
+    * @param[in] specs the filter specifications
+    * @param[in] nsplit order threshold above which a design is parallelized
+    * internally instead of across designs
+    * @return the outputs of the Parks-McClellan algorithm, in the same order
+    * as the specifications. Failed designs are reported through the status
+    * field of their output object, they do not stop the rest of the batch.
+    *
+    * @code
+    * std::vector<pmspec_t<double>> specs(2);
+    * specs[0].n = 100; specs[0].f = {0.0, 0.4, 0.5, 1.0};
+    * specs[0].a = {1.0, 1.0, 0.0, 0.0}; specs[0].w = {1.0, 10.0};
+    * specs[1] = specs[0]; specs[1].n = 120;
+    * std::vector<pmoutput_t<double>> outputs = firpm_batch(specs);
+    * @endcode
+    */
+    template<typename T>
+    std::vector<pmoutput_t<T>> firpm_batch(std::vector<pmspec_t<T>> const& specs,
+                std::size_t nsplit = 2000u);
+
+    /*! Designs a family of filters along a parameter path (e.g. a band edge
+    * or a weight that varies in small steps). The designs are computed in
+    * the order of the parameter values, each one starting from the
+    * reference of the previous design, whose points are moved along with
+    * the band edges (see <tt>pmopts_t::x0</tt>), so that it usually
+    * converges in a few iterations. The path can be cut into
+    * <tt>nchains</tt> contiguous pieces that are designed in parallel, the
+    * first design of each piece being started with the initialization
+    * strategy of its specification. A design that fails from the previous
+    * reference is computed again from scratch, and specifications that
+    * give their own starting reference keep it. The observers of the
+    * designs are called from the threads running the chains, one call at a
+    * time.
+    * @param[in] spec builds the filter specification for a parameter
+    * value (it is called by the calling thread, once per value, before
+    * the designs start)
+    * @param[in] params the parameter values, in the order of the path
+    * @param[in] nchains the number of pieces designed in parallel
+    * @return the outputs of the Parks-McClellan algorithm, in the order of
+    * the parameter values
+    *
+    * @code
+    * std::vector<double> edges;
+    * for(std::size_t i{0u}; i < 50u; ++i)
+    *     edges.push_back(0.41 + 0.001 * i);
+    * auto outputs = firpm_sweep<double>([](double const& fs) {
+    *     pmspec_t<double> spec;
+    *     spec.n = 100; spec.f = {0.0, 0.4, fs, 1.0};
+    *     spec.a = {1.0, 1.0, 0.0, 0.0}; spec.w = {1.0, 10.0};
+    *     return spec;
+    * }, edges);
+    * @endcode
+    */
+    template<typename T>
+    std::vector<pmoutput_t<T>> firpm_sweep(
+                std::function<pmspec_t<T>(T const&)> const& spec,
+                std::vector<T> const& params,
+                std::size_t nchains = 1u);
+
+    /*! Largest deviation of a passband with a peak-to-peak ripple of
+    * <tt>db</tt> decibels (for an amplitude of 1)
+    * @param[in] db the passband ripple, in dB
+    * @return the deviation from the amplitude of the band
+    */
+    double ripple2dev(double db);
+
+    /*! Largest deviation of a stopband with an attenuation of <tt>db</tt>
+    * decibels (relative to an amplitude of 1)
+    * @param[in] db the stopband attenuation, in dB
+    * @return the deviation from zero
+    */
+    double atten2dev(double db);
+
+    /*! Minimum-order search: finds the type I or II filter of smallest order
+    * whose deviation from the amplitude of each band stays below the one
+    * given for it. The search starts from the Kaiser estimate of the order,
+    * brackets the smallest order that meets the deviations and narrows the
+    * bracket down. Each round evaluates several orders in parallel, each
+    * design starting from the reference of the nearest order designed
+    * before it (see <tt>pmopts_t::x0</tt>). Only even orders are tried if
+    * the amplitude at \f$\pi\f$ is not zero (type II filters vanish there).
+    * The observer of <tt>opts</tt> follows all these designs: it is called
+    * from the threads running them, one call at a time.
+    * @param[in] f frequency ranges of each band of interest (as for
+    * <tt>firpm</tt>)
+    * @param[in] a ideal amplitude at each point of f
+    * @param[in] dev largest deviation allowed in each band (see
+    * <tt>ripple2dev</tt> and <tt>atten2dev</tt>)
+    * @param[in] eps convergence parameter threshold
+    * @param[in] nmax degree used by the CPR method on each subinterval
+    * @param[in] prec numerical precision of the MPFR type
+    * @param[in] opts additional controls applied to every design
+    * @return the output of the Parks-McClellan algorithm for the smallest
+    * order found (the order is the number of coefficients minus one). The
+    * bands are weighted by the inverse of their deviation relative to the
+    * largest one, so the deviation reached in band i is
+    * \f$\delta \cdot dev_i / \max(dev)\f$, and the design meets the
+    * specification when \f$\delta \leq \max(dev)\f$. If no order up to a
+    * large multiple of the estimate does, the largest design that converged
+    * is returned with STATUS_ORDER_LIMIT. Errors in the specification are
+    * reported by the status of the output, as for <tt>firpm</tt>.
+    *
+    * @code
+    * // 0.1 dB ripple up to 0.4, 80 dB attenuation from 0.45
+    * pmoutput_t<double> output = firpmord<double>({0.0, 0.4, 0.45, 1.0},
+    *         {1.0, 1.0, 0.0, 0.0}, {ripple2dev(0.1), atten2dev(80.0)});
+    * std::size_t n = output.h.size() - 1u;
+    * @endcode
+    */
+    template<typename T>
+    pmoutput_t<T> firpmord(std::vector<T> const& f,
+                std::vector<T> const& a,
+                std::vector<double> const& dev,
+                double eps = 0.01,
+                std::size_t nmax = 4u,
+                unsigned long prec = 165ul,
+                pmopts_t<T> const& opts = {});
 
 } // namespace pm
 
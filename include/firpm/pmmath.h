@@ -12,12 +12,34 @@
 // Copyright (C) 2019  G. Smecher
 
 #include <cmath>
+#include <limits>
+#include "ddouble.h"
 #ifdef HAVE_MPFR
 	#include "mpreal.h"
 #endif
+#ifdef HAVE_BOOST_MP
+	#include <boost/multiprecision/cpp_bin_float.hpp>
+	#ifdef HAVE_QUADMATH
+		#include <boost/multiprecision/float128.hpp>
+	#endif
+	#include <boost/multiprecision/eigen.hpp>
+	#include <boost/math/constants/constants.hpp>
+#endif
 
 namespace pm {
 
+#ifdef HAVE_QUADMATH
+	/* IEEE quadruple precision (113-bit significand): GCC's __float128,
+	 * computed with libquadmath, behind the Boost.Multiprecision wrapper
+	 * that makes its math functions visible to Eigen */
+	using float128 = boost::multiprecision::float128;
+#endif
+#ifdef HAVE_BOOST_MP
+	/* IEEE octuple precision (237-bit significand), stored on the stack
+	 * and without any global precision setting */
+	using float256 = boost::multiprecision::cpp_bin_float_oct;
+#endif
+
 	namespace pmmath {
 		template<typename T> T sin(T);
 		template<typename T> T cos(T);
@@ -42,7 +64,15 @@ namespace pm {
 
 		template<typename T> long round(T);
 
+		template<typename T> T frexp(T, int*);
+		template<typename T> T ldexp(T, int);
+
+		/* Conversion between the supported types (the MPFR values are
+		 * created with the current default precision) */
+		template<typename To, typename From> inline To convert(From x) { return static_cast<To>(x); };
+
 		template<typename T> T const_pi(void);
+		template<typename T> T epsilon(void);
 
 		/* Specializations: double precision */
 		template<> inline double sin<double>(double x) { return std::sin(x); };
@@ -68,7 +98,11 @@ namespace pm {
 
 		template<> inline long round<double>(double x) { return std::round(x); };
 
+		template<> inline double frexp<double>(double x, int* e) { return std::frexp(x, e); };
+		template<> inline double ldexp<double>(double x, int e) { return std::ldexp(x, e); };
+
 		template<> inline double const_pi<double>(void) { return M_PI; };
+		template<> inline double epsilon<double>(void) { return std::numeric_limits<double>::epsilon(); };
 
 		/* Specializations: long double precision */
 		template<> inline long double sin<long double>(long double x) { return sinl(x); };
@@ -94,7 +128,115 @@ namespace pm {
 
 		template<> inline long round<long double>(long double x) { return std::round(x); };
 
+		template<> inline long double frexp<long double>(long double x, int* e) { return frexpl(x, e); };
+		template<> inline long double ldexp<long double>(long double x, int e) { return ldexpl(x, e); };
+
 		template<> inline long double const_pi<long double>(void) { return M_PI; };
+		template<> inline long double epsilon<long double>(void) { return std::numeric_limits<long double>::epsilon(); };
+
+		/* Specializations: double-double */
+		template<> inline ddouble sin<ddouble>(ddouble x) { return dd::sin(x); };
+		template<> inline ddouble cos<ddouble>(ddouble x) { return dd::cos(x); };
+		template<> inline ddouble tan<ddouble>(ddouble x) { return dd::tan(x); };
+
+		template<> inline ddouble asin<ddouble>(ddouble x) { return dd::asin(x); };
+		template<> inline ddouble acos<ddouble>(ddouble x) { return dd::acos(x); };
+		template<> inline ddouble atan<ddouble>(ddouble x) { return dd::atan(x); };
+
+		template<> inline ddouble log<ddouble>(ddouble x) { return dd::log(x); };
+		template<> inline ddouble exp<ddouble>(ddouble x) { return dd::exp(x); };
+		template<> inline ddouble sqrt<ddouble>(ddouble x) { return dd::sqrt(x); };
+		template<> inline ddouble pow<ddouble>(ddouble x, ddouble y) { return dd::pow(x, y); };
+
+		template<> inline ddouble fabs<ddouble>(ddouble x) { return dd::fabs(x); };
+		template<> inline ddouble fmax<ddouble>(ddouble x, ddouble y) { return dd::fmax(x, y); };
+		template<> inline ddouble fmin<ddouble>(ddouble x, ddouble y) { return dd::fmin(x, y); };
+
+		template<> inline bool signbit<ddouble>(ddouble x) { return dd::signbit(x); };
+		template<> inline bool isfinite<ddouble>(ddouble x) { return dd::isfinite(x); };
+		template<> inline bool isnan<ddouble>(ddouble x) { return dd::isnan(x); };
+
+		template<> inline long round<ddouble>(ddouble x) {
+			ddouble r = dd::floor(dd::fabs(x) + ddouble(0.5)); long l = static_cast<long>(r);
+			return x.hi < 0.0 ? -l : l; };
+
+		template<> inline ddouble frexp<ddouble>(ddouble x, int* e) { return dd::frexp(x, e); };
+		template<> inline ddouble ldexp<ddouble>(ddouble x, int e) { return dd::ldexp(x, e); };
+
+		template<> inline ddouble const_pi<ddouble>(void) { return dd::ddimpl::pi; };
+		template<> inline ddouble epsilon<ddouble>(void) { return std::numeric_limits<ddouble>::epsilon(); };
+
+#ifdef HAVE_QUADMATH
+		/* Specializations: quadruple precision */
+		template<> inline float128 sin<float128>(float128 x) { return boost::multiprecision::sin(x); };
+		template<> inline float128 cos<float128>(float128 x) { return boost::multiprecision::cos(x); };
+		template<> inline float128 tan<float128>(float128 x) { return boost::multiprecision::tan(x); };
+
+		template<> inline float128 asin<float128>(float128 x) { return boost::multiprecision::asin(x); };
+		template<> inline float128 acos<float128>(float128 x) { return boost::multiprecision::acos(x); };
+		template<> inline float128 atan<float128>(float128 x) { return boost::multiprecision::atan(x); };
+
+		template<> inline float128 log<float128>(float128 x) { return boost::multiprecision::log(x); };
+		template<> inline float128 exp<float128>(float128 x) { return boost::multiprecision::exp(x); };
+		template<> inline float128 sqrt<float128>(float128 x) { return boost::multiprecision::sqrt(x); };
+		template<> inline float128 pow<float128>(float128 x, float128 y) { return boost::multiprecision::pow(x, y); };
+
+		template<> inline float128 fabs<float128>(float128 x) { return boost::multiprecision::fabs(x); };
+		template<> inline float128 fmax<float128>(float128 x, float128 y) { return x < y ? y : x; };
+		template<> inline float128 fmin<float128>(float128 x, float128 y) { return y < x ? y : x; };
+
+		template<> inline bool signbit<float128>(float128 x) { return boost::multiprecision::signbit(x); };
+		template<> inline bool isfinite<float128>(float128 x) { return (boost::multiprecision::isfinite)(x); };
+		template<> inline bool isnan<float128>(float128 x) { return (boost::multiprecision::isnan)(x); };
+
+		template<> inline long round<float128>(float128 x) { return boost::multiprecision::round(x).convert_to<long>(); };
+
+		template<> inline float128 frexp<float128>(float128 x, int* e) { return boost::multiprecision::frexp(x, e); };
+		template<> inline float128 ldexp<float128>(float128 x, int e) { return boost::multiprecision::ldexp(x, e); };
+
+		template<> inline ddouble convert<ddouble, float128>(float128 x) {
+			double h = static_cast<double>(x); return ddouble(h, static_cast<double>(x - h)); };
+		template<> inline float128 convert<float128, ddouble>(ddouble x) { return float128(x.hi) + x.lo; };
+
+		template<> inline float128 const_pi<float128>(void) { return boost::math::constants::pi<float128>(); };
+		template<> inline float128 epsilon<float128>(void) { return std::numeric_limits<float128>::epsilon(); };
+#endif
+
+#ifdef HAVE_BOOST_MP
+		/* Specializations: octuple precision */
+		template<> inline float256 sin<float256>(float256 x) { return boost::multiprecision::sin(x); };
+		template<> inline float256 cos<float256>(float256 x) { return boost::multiprecision::cos(x); };
+		template<> inline float256 tan<float256>(float256 x) { return boost::multiprecision::tan(x); };
+
+		template<> inline float256 asin<float256>(float256 x) { return boost::multiprecision::asin(x); };
+		template<> inline float256 acos<float256>(float256 x) { return boost::multiprecision::acos(x); };
+		template<> inline float256 atan<float256>(float256 x) { return boost::multiprecision::atan(x); };
+
+		template<> inline float256 log<float256>(float256 x) { return boost::multiprecision::log(x); };
+		template<> inline float256 exp<float256>(float256 x) { return boost::multiprecision::exp(x); };
+		template<> inline float256 sqrt<float256>(float256 x) { return boost::multiprecision::sqrt(x); };
+		template<> inline float256 pow<float256>(float256 x, float256 y) { return boost::multiprecision::pow(x, y); };
+
+		template<> inline float256 fabs<float256>(float256 x) { return boost::multiprecision::fabs(x); };
+		template<> inline float256 fmax<float256>(float256 x, float256 y) { return x < y ? y : x; };
+		template<> inline float256 fmin<float256>(float256 x, float256 y) { return y < x ? y : x; };
+
+		template<> inline bool signbit<float256>(float256 x) { return boost::multiprecision::signbit(x); };
+		template<> inline bool isfinite<float256>(float256 x) { return (boost::multiprecision::isfinite)(x); };
+		template<> inline bool isnan<float256>(float256 x) { return (boost::multiprecision::isnan)(x); };
+
+		template<> inline long round<float256>(float256 x) { return boost::multiprecision::round(x).convert_to<long>(); };
+
+		template<> inline float256 frexp<float256>(float256 x, int* e) { return boost::multiprecision::frexp(x, e); };
+		template<> inline float256 ldexp<float256>(float256 x, int e) { return boost::multiprecision::ldexp(x, e); };
+
+		template<> inline ddouble convert<ddouble, float256>(float256 x) {
+			double h = static_cast<double>(x); return ddouble(h, static_cast<double>(x - h)); };
+		template<> inline float256 convert<float256, ddouble>(ddouble x) { return float256(x.hi) + x.lo; };
+
+		template<> inline float256 const_pi<float256>(void) { return boost::math::constants::pi<float256>(); };
+		template<> inline float256 epsilon<float256>(void) { return std::numeric_limits<float256>::epsilon(); };
+#endif
 
 		/* Specialization: multiple precision mpreal */
 #ifdef HAVE_MPFR
@@ -121,10 +263,64 @@ namespace pm {
 
 		template<> inline long round<mpfr::mpreal>(mpfr::mpreal x) { return mpfr::round(x).toLong(); };
 
+		template<> inline mpfr::mpreal frexp<mpfr::mpreal>(mpfr::mpreal x, int* e) {
+			mp_exp_t me; mpfr::mpreal r = mpfr::frexp(x, &me); *e = (int)me; return r; };
+		template<> inline mpfr::mpreal ldexp<mpfr::mpreal>(mpfr::mpreal x, int e) { return mpfr::ldexp(x, e); };
+
+		template<> inline double convert<double, mpfr::mpreal>(mpfr::mpreal x) { return x.toDouble(); };
+		template<> inline long double convert<long double, mpfr::mpreal>(mpfr::mpreal x) { return x.toLDouble(); };
+
+		template<> inline ddouble convert<ddouble, mpfr::mpreal>(mpfr::mpreal x) {
+			double h = x.toDouble(); return ddouble(h, (x - h).toDouble()); };
+		template<> inline mpfr::mpreal convert<mpfr::mpreal, ddouble>(ddouble x) {
+			return mpfr::mpreal(x.hi) + x.lo; };
+
 		template<> inline mpfr::mpreal const_pi<mpfr::mpreal>(void) { return mpfr::const_pi(); };
+		template<> inline mpfr::mpreal epsilon<mpfr::mpreal>(void) { return mpfr::machine_epsilon(); };
 #endif
 
 	} // namespace pmmath
+
+	/* Sets the precision of the numbers of type T created by the calling
+	 * thread for the lifetime of the object, and restores the previous one
+	 * afterwards. Only the MPFR type has such a setting (its default
+	 * precision is local to each thread), so this does nothing for the
+	 * other types. The precision is only changed when it differs from the
+	 * current one, so that nested scopes are cheap. */
+	template<typename T>
+	class precscope_t {
+	public:
+		explicit precscope_t(unsigned long) {}
+		precscope_t(precscope_t const&) = delete;
+		precscope_t& operator=(precscope_t const&) = delete;
+
+		/* the precision in use in the calling thread (0 if not relevant) */
+		static unsigned long current() { return 0ul; }
+	};
+
+#ifdef HAVE_MPFR
+	template<>
+	class precscope_t<mpfr::mpreal> {
+	public:
+		explicit precscope_t(unsigned long prec)
+			: prev(mpfr::mpreal::get_default_prec()) {
+			if((mpfr_prec_t)prec != prev)
+				mpfr::mpreal::set_default_prec(prec);
+		}
+		~precscope_t() {
+			if(mpfr::mpreal::get_default_prec() != prev)
+				mpfr::mpreal::set_default_prec(prev);
+		}
+		precscope_t(precscope_t const&) = delete;
+		precscope_t& operator=(precscope_t const&) = delete;
+
+		static unsigned long current() { return mpfr::mpreal::get_default_prec(); }
+
+	private:
+		mpfr_prec_t prev;
+	};
+#endif
+
 } // namespace pm
 
 #endif
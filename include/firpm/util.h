@@ -22,6 +22,7 @@
 #include <climits>
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <cmath>
 #include <Eigen/Dense>
 #include <Eigen/Eigenvalues>
@@ -16,16 +16,48 @@ static double to_double(long double x) { return static_cast<double>(x); }
 static double to_double(const mpfr::mpreal& x) { return x.toDouble(); }
 #endif
 
+/* Starting reference of a design, given like the band edges as normalized
+ * frequencies in [0, 1]; an empty x0 keeps the uniform initialization. */
+template <typename T>
+static pm::pmopts_t<T> warm_opts(std::vector<double> const& x0)
+{
+    pm::pmopts_t<T> opts;
+    for(auto const& it : x0)
+        opts.x0.push_back(pm::pmmath::const_pi<T>() * T(it));
+    opts.x0space = pm::space_t::FREQ;
+    return opts;
+}
+
+/* Result of a design: the taps, and if asked for, the final reference too,
+ * as normalized frequencies in increasing order (the form taken by x0). */
+template <typename T>
+static py::object design_result(pm::pmoutput_t<T> const& output, bool return_x)
+{
+    std::vector<double> hd(output.h.size());
+    for(std::size_t i{0u}; i < output.h.size(); ++i)
+        hd[i] = to_double(output.h[i]);
+    if(!return_x)
+        return py::cast(hd);
+    std::vector<double> xd(output.x.size());
+    for(std::size_t i{0u}; i < output.x.size(); ++i)
+        xd[output.x.size() - 1u - i] = to_double(
+                pm::pmmath::acos(output.x[i]) / pm::pmmath::const_pi<T>());
+    return py::make_tuple(hd, xd);
+}
+
 /* Custom-band Parks-McClellan: per-band amplitude and weight are arbitrary
  * Python callables evaluated at omega in [0, pi] (FREQ space).  Supports
  * type I (even n) and type II (odd n).  Delegates to pm::firpm(n, fbands)
  * which handles the cos(omega/2) basis change and tap recovery internally. */
 template <typename T>
-static std::vector<double> firpm_bands_impl(std::size_t n,
+static py::object firpm_bands_impl(std::size_t n,
         std::vector<std::tuple<double, double, py::function, py::function>> bands,
         double eps, std::size_t nmax, unsigned long prec,
-        std::vector<double> /*x0*/)
+        std::vector<double> x0, bool return_x)
 {
+    /* the band edges are created with the precision of the design; the
+     * previous precision of the calling thread is restored on return */
+    pm::precscope_t<T> scope(prec);
     std::vector<pm::band_t<T>> fbands(bands.size());
     for(std::size_t i{0u}; i < bands.size(); ++i) {
         double f0 = std::get<0>(bands[i]), f1 = std::get<1>(bands[i]);
@@ -50,15 +82,14 @@ static std::vector<double> firpm_bands_impl(std::size_t n,
         };
     }
 
+    pm::pmopts_t<T> opts = warm_opts<T>(x0);
     pm::pmoutput_t<T> output = [&]() {
         py::gil_scoped_release nogil;
-        return pm::firpm<T>(n, fbands, eps, nmax, pm::init_t::UNIFORM, 0u, pm::init_t::UNIFORM, prec);
+        return pm::firpm<T>(n, fbands, eps, nmax, pm::init_t::UNIFORM, 0u, pm::init_t::UNIFORM,
+                prec, opts);
     }();
 
-    std::vector<double> hd(output.h.size());
-    for(std::size_t i{0u}; i < output.h.size(); ++i)
-        hd[i] = to_double(output.h[i]);
-    return hd;
+    return design_result(output, return_x);
 }
 
 PYBIND11_MODULE(pyfirpm, m){
@@ -76,8 +107,12 @@ PYBIND11_MODULE(pyfirpm, m){
               pm::init_t strategy,
               std::size_t depth,
               pm::init_t rstrategy,
-              unsigned long prec) {
-            return firpm<double>(n, f, a, w, eps, nmax, strategy, depth, rstrategy, prec).h;
+              unsigned long prec,
+              std::vector<double> x0,
+              bool return_x) {
+            pm::pmoutput_t<double> output = firpm<double>(n, f, a, w, eps, nmax,
+                    strategy, depth, rstrategy, prec, warm_opts<double>(x0));
+            return design_result(output, return_x);
         },
         "n"_a,
         "f"_a,
@@ -89,25 +124,32 @@ PYBIND11_MODULE(pyfirpm, m){
         "depth"_a=0u,
         "rstrategy"_a=pm::init_t::UNIFORM,
         "prec"_a=165ul,
-        "Parks-McClellan routine for implementing type I and II FIR filters.");
+        "x0"_a=std::vector<double>{},
+        "return_x"_a=false,
+        "Parks-McClellan routine for implementing type I and II FIR filters.  "
+        "x0 optionally gives a starting reference (normalized frequencies), "
+        "which replaces the initialization strategy.  Returns tap vector h, "
+        "or (h, x) with the final reference x if return_x is set.");
 
     m.def("firpm_bands", &firpm_bands_impl<double>,
         "n"_a, "bands"_a, "eps"_a=0.01, "nmax"_a=4, "prec"_a=165ul,
-        "x0"_a=std::vector<double>{},
+        "x0"_a=std::vector<double>{}, "return_x"_a=false,
         "Parks-McClellan with per-band callable amplitude/weight (type I/II, "
-        "double precision).  Returns tap vector h.");
+        "double precision).  x0 optionally gives a starting reference "
+        "(normalized frequencies).  Returns tap vector h, or (h, x) with the "
+        "final reference x if return_x is set.");
 
 #if HAVE_MPFR
     m.def("firpm_bands_mp", [](std::size_t n,
               std::vector<std::tuple<double, double, py::function, py::function>> bands,
               double eps, std::size_t nmax, unsigned long prec,
-              std::vector<double> x0) {
-            mpfr::mpreal::set_default_prec(prec);
-            return firpm_bands_impl<mpfr::mpreal>(n, bands, eps, nmax, prec, x0);
+              std::vector<double> x0, bool return_x) {
+            return firpm_bands_impl<mpfr::mpreal>(n, bands, eps, nmax, prec, x0, return_x);
         },
         "n"_a, "bands"_a, "eps"_a=0.01, "nmax"_a=4, "prec"_a=165ul,
-        "x0"_a=std::vector<double>{},
+        "x0"_a=std::vector<double>{}, "return_x"_a=false,
         "As firpm_bands (type I/II), computed in MPFR arbitrary precision (prec bits); "
-        "taps extracted before rounding to double.  Returns tap vector h.");
+        "taps extracted before rounding to double.  Returns tap vector h, or "
+        "(h, x) if return_x is set.");
 #endif
 }
@@ -18,6 +18,7 @@ namespace pm {
             out[i].amplitude = in[n - i].amplitude;
             out[i].xs        = in[n - i].xs;
             out[i].part      = in[n - i].part;
+            out[i].pwl       = in[n - i].pwl;
             if (direction == convdir_t::FROMFREQ)
             {
                 out[i].start = pmmath::cos(in[n - i].stop);
@@ -37,22 +38,152 @@ namespace pm {
         }
     }
 
+    template<typename T>
+    void pwlinit(band_t<T>& band, std::vector<T> const& freq,
+            std::vector<T> const& amp, T const& weight)
+    {
+        band.pwl.freq = freq;
+        band.pwl.cheby.resize(freq.size());
+        for (std::size_t i{0u}; i < freq.size(); ++i)
+            band.pwl.cheby[i] = pmmath::cos(freq[i]);
+        band.pwl.amp = amp;
+        band.pwl.weight = weight;
+        band.pwl.halfcos = false;
+
+        band.start = freq.front();
+        band.stop  = freq.back();
+        band.part  = freq;
+        band.space = space_t::FREQ;
+
+        pwl_t<T> p = band.pwl;
+        band.amplitude = [p](space_t space, T x) -> T {
+            return pwlamp(p, space, x);
+        };
+        band.weight = [p](space_t space, T x) -> T {
+            return pwlweight(p, space, x);
+        };
+    }
+
+    template<typename To, typename From>
+    void bandcast(std::vector<band_t<To>>& out,
+            std::vector<band_t<From>> const& in)
+    {
+        auto conv = [](std::vector<From> const& v) {
+            std::vector<To> r(v.size());
+            for(std::size_t i{0u}; i < v.size(); ++i)
+                r[i] = pmmath::convert<To>(v[i]);
+            return r;
+        };
+        out.resize(in.size());
+        for (std::size_t i{0u}; i < in.size(); ++i)
+        {
+            std::function<From(space_t, From)> amplitude = in[i].amplitude;
+            std::function<From(space_t, From)> weight = in[i].weight;
+            out[i].space = in[i].space;
+            out[i].start = pmmath::convert<To>(in[i].start);
+            out[i].stop = pmmath::convert<To>(in[i].stop);
+            out[i].xs = in[i].xs;
+            out[i].part = conv(in[i].part);
+            out[i].amplitude = [amplitude](space_t space, To x) -> To {
+                return pmmath::convert<To>(amplitude(space, pmmath::convert<From>(x)));
+            };
+            out[i].weight = [weight](space_t space, To x) -> To {
+                return pmmath::convert<To>(weight(space, pmmath::convert<From>(x)));
+            };
+            out[i].pwl = pwl_t<To>{};
+            if (!in[i].pwl.amp.empty()) {
+                out[i].pwl.freq = conv(in[i].pwl.freq);
+                out[i].pwl.cheby = conv(in[i].pwl.cheby);
+                out[i].pwl.amp = conv(in[i].pwl.amp);
+                out[i].pwl.weight = pmmath::convert<To>(in[i].pwl.weight);
+                out[i].pwl.halfcos = in[i].pwl.halfcos;
+            }
+        }
+    }
+
     /* Template instantiation */
     template void bandconv<double>(
         std::vector<band_t<double>>& out,
         std::vector<band_t<double>>& in,
             convdir_t direction);
 
+    template void pwlinit<double>(band_t<double>& band,
+            std::vector<double> const& freq,
+            std::vector<double> const& amp, double const& weight);
+
     template void bandconv<long double>(
         std::vector<band_t<long double>>& out,
         std::vector<band_t<long double>>& in,
             convdir_t direction);
 
+    template void pwlinit<long double>(band_t<long double>& band,
+            std::vector<long double> const& freq,
+            std::vector<long double> const& amp, long double const& weight);
+
+    template void bandcast<double, long double>(
+        std::vector<band_t<double>>& out,
+        std::vector<band_t<long double>> const& in);
+
+    template void bandconv<ddouble>(
+        std::vector<band_t<ddouble>>& out,
+        std::vector<band_t<ddouble>>& in,
+            convdir_t direction);
+
+    template void pwlinit<ddouble>(band_t<ddouble>& band,
+            std::vector<ddouble> const& freq,
+            std::vector<ddouble> const& amp, ddouble const& weight);
+
+    template void bandcast<long double, ddouble>(
+        std::vector<band_t<long double>>& out,
+        std::vector<band_t<ddouble>> const& in);
+
+#ifdef HAVE_QUADMATH
+    template void bandconv<float128>(
+        std::vector<band_t<float128>>& out,
+        std::vector<band_t<float128>>& in,
+            convdir_t direction);
+
+    template void pwlinit<float128>(band_t<float128>& band,
+            std::vector<float128> const& freq,
+            std::vector<float128> const& amp, float128 const& weight);
+
+    template void bandcast<ddouble, float128>(
+        std::vector<band_t<ddouble>>& out,
+        std::vector<band_t<float128>> const& in);
+#endif
+
+#ifdef HAVE_BOOST_MP
+    template void bandconv<float256>(
+        std::vector<band_t<float256>>& out,
+        std::vector<band_t<float256>>& in,
+            convdir_t direction);
+
+    template void pwlinit<float256>(band_t<float256>& band,
+            std::vector<float256> const& freq,
+            std::vector<float256> const& amp, float256 const& weight);
+
+    template void bandcast<ddouble, float256>(
+        std::vector<band_t<ddouble>>& out,
+        std::vector<band_t<float256>> const& in);
+#endif
+
 #ifdef HAVE_MPFR
     template void bandconv<mpfr::mpreal>(
         std::vector<band_t<mpfr::mpreal>>& out,
         std::vector<band_t<mpfr::mpreal>>& in,
             convdir_t direction);
+
+    template void pwlinit<mpfr::mpreal>(band_t<mpfr::mpreal>& band,
+            std::vector<mpfr::mpreal> const& freq,
+            std::vector<mpfr::mpreal> const& amp, mpfr::mpreal const& weight);
+
+    template void bandcast<double, mpfr::mpreal>(
+        std::vector<band_t<double>>& out,
+        std::vector<band_t<mpfr::mpreal>> const& in);
+
+    template void bandcast<long double, mpfr::mpreal>(
+        std::vector<band_t<long double>>& out,
+        std::vector<band_t<mpfr::mpreal>> const& in);
 #endif
 
 } // namespace pm
\ No newline at end of file
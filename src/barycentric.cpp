@@ -3,28 +3,94 @@
 
 #include "firpm/barycentric.h"
 #include "firpm/pmmath.h"
+#include "firpm/mpfrarena.h"
+#include <omp.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+    #include <immintrin.h>
+#endif
 
 namespace pm {
 
+    // number of nodes whose weights are computed together by baryweights
+    constexpr std::size_t BARY_WBLOCK = 8u;
+    // number of factors multiplied together before the partial products are
+    // checked; the factors 2(x_i - x_j) are at most 4 in magnitude and, for
+    // distinct nodes of [-1, 1], not smaller than twice the machine epsilon
+    constexpr std::size_t BARY_RENORM = 8u;
+    // partial products outside of [2^-BARY_RANGE, 2^BARY_RANGE] are
+    // renormalized, so that they stay in the double precision range after
+    // BARY_RENORM more factors
+    constexpr int BARY_RANGE = 500;
+
+    // computes the products prod_{j != i} 2(x_i - x_j) for the nb <=
+    // BARY_WBLOCK nodes starting at index i0 as mantissas (denom) and binary
+    // exponents (exponent); the nodes of the block are handled in parallel
+    // lanes, each of which only needs a renormalization once in a while
+    template<typename T>
+    void baryprods(T* denom, int* exponent, std::size_t i0, std::size_t nb,
+            std::vector<T> const& x)
+    {
+        T one = 1;
+        T lo = pmmath::ldexp(one, -BARY_RANGE);
+        T hi = pmmath::ldexp(one, BARY_RANGE);
+        T xi[BARY_WBLOCK];
+        std::size_t ii[BARY_WBLOCK];
+        int e;
+        for (std::size_t l{0u}; l < BARY_WBLOCK; ++l) {
+            // incomplete blocks are padded with copies of their first node
+            ii[l] = (l < nb) ? i0 + l : i0;
+            xi[l] = x[ii[l]];
+            denom[l] = 1;
+            exponent[l] = 0;
+        }
+        for (std::size_t j{0u}; j < x.size(); j += BARY_RENORM)
+        {
+            std::size_t last = std::min(j + BARY_RENORM, x.size());
+            for (std::size_t k{j}; k < last; ++k)
+            {
+                T xk = x[k];
+                #pragma omp simd
+                for (std::size_t l = 0u; l < BARY_WBLOCK; ++l)
+                    denom[l] *= (ii[l] == k) ? one : (xi[l] - xk) * 2;
+            }
+            for (std::size_t l{0u}; l < BARY_WBLOCK; ++l)
+            {
+                T a = pmmath::fabs(denom[l]);
+                if (a < lo || a > hi) {
+                    denom[l] = pmmath::frexp(denom[l], &e);
+                    exponent[l] += e;
+                }
+            }
+        }
+    }
+
     template<typename T>
     void baryweights(std::vector<T>& w,
             std::vector<T>& x)
     {
         if(x.size() > 500u)
         {
-            for(std::size_t i{0u}; i < x.size(); ++i)
+            // the products are accumulated as a mantissa and a separate
+            // binary exponent, which avoids both the over/underflow of the
+            // direct product and the transcendental functions of the
+            // log-sum formulation
+            std::size_t nblocks = (x.size() + BARY_WBLOCK - 1u) / BARY_WBLOCK;
+            unsigned long prec = precscope_t<T>::current();
+            #pragma omp parallel if(!omp_in_parallel())
             {
+                precscope_t<T> scope(prec);
                 T one = 1;
-                T denom = 0.0;
-                T xi = x[i];
-                for(std::size_t j{0u}; j < x.size(); ++j)
+                T denom[BARY_WBLOCK];
+                int exponent[BARY_WBLOCK];
+                #pragma omp for
+                for(std::size_t b = 0u; b < nblocks; ++b)
                 {
-                    if (j != i) {
-                        denom += pmmath::log(((xi - x[j] > 0) ? (xi - x[j]) : (x[j] - xi)));
-                        one *= ((xi - x[j] > 0) ? 1 : -1);
-                    }
+                    std::size_t i0 = b * BARY_WBLOCK;
+                    std::size_t nb = std::min(BARY_WBLOCK, x.size() - i0);
+                    baryprods(denom, exponent, i0, nb, x);
+                    for(std::size_t l{0u}; l < nb; ++l)
+                        w[i0 + l] = pmmath::ldexp(one / denom[l], -exponent[l]);
                 }
-                w[i] = one / pmmath::exp(denom + pmmath::log(2.0)* (x.size() - 1));
             }
         }
         else
@@ -47,16 +113,85 @@ namespace pm {
     }
 
 
+    template<typename T>
+    bool bandsorted(std::vector<band_t<T>> const& bands)
+    {
+        for (std::size_t i{0u}; i < bands.size(); ++i)
+        {
+            if (!(bands[i].start <= bands[i].stop))
+                return false;
+            if (i + 1u < bands.size() && !(bands[i].stop <= bands[i + 1u].start))
+                return false;
+        }
+        return true;
+    }
+
+    // index of the first band containing x (bands.size() if there is none);
+    // for sorted bands this is the first band whose right edge is not to the
+    // left of x, provided that x is not to the left of its start
+    template<typename T>
+    std::size_t bandfind(T const& x, std::vector<band_t<T>> const& bands,
+            bool sorted)
+    {
+        if (sorted) {
+            auto it = std::lower_bound(bands.begin(), bands.end(), x,
+                    [](band_t<T> const& b, T const& val) {
+                        return b.stop < val;
+                    });
+            if (it != bands.end() && x >= it->start)
+                return it - bands.begin();
+            return bands.size();
+        }
+        for (std::size_t i{0u}; i < bands.size(); ++i)
+            if (x >= bands[i].start && x <= bands[i].stop)
+                return i;
+        return bands.size();
+    }
+
+    // ideal response and weight of band b at x; bands with a piecewise-linear
+    // description are evaluated directly instead of through their callbacks
+    template<typename T>
+    void bandvals(T& D, T& W, band_t<T> const& b, T const& x)
+    {
+        if (!b.pwl.amp.empty()) {
+            D = pwlamp(b.pwl, b.space, x);
+            W = pwlweight(b.pwl, b.space, x);
+        } else {
+            D = b.amplitude(b.space, x);
+            W = b.weight(b.space, x);
+        }
+    }
+
     template<typename T>
     void idealvals(T& D, T& W,
             T const& x, std::vector<band_t<T>>& bands)
     {
-        for (auto &it : bands) {
-            if (x >= it.start && x <= it.stop) {
-                D = it.amplitude(it.space, x);
-                W = it.weight(it.space, x);
-                return;
-            }
+        std::size_t i = bandfind(x, bands, false);
+        if (i < bands.size())
+            bandvals(D, W, bands[i], x);
+    }
+
+    template<typename T>
+    void idealvals(std::vector<T>& D, std::vector<T>& W,
+            std::vector<T> const& x, std::vector<band_t<T>>& bands)
+    {
+        idealvals(D, W, x, bands, bandsorted(bands));
+    }
+
+    template<typename T>
+    void idealvals(std::vector<T>& D, std::vector<T>& W,
+            std::vector<T> const& x, std::vector<band_t<T>>& bands,
+            bool sorted)
+    {
+        D.resize(x.size());
+        W.resize(x.size());
+        for (std::size_t i{0u}; i < x.size(); ++i)
+        {
+            std::size_t b = bandfind(x[i], bands, sorted);
+            if (b < bands.size())
+                bandvals(D[i], W[i], bands[b], x[i]);
+            else
+                D[i] = W[i] = 0;
         }
     }
 
@@ -102,6 +237,24 @@ namespace pm {
         delta = num / denom;
     }
 
+    template<typename T>
+    void compdelta(T& delta, std::vector<T>& w,
+            std::vector<T>& D, std::vector<T>& W)
+    {
+        T num, denom, buffer;
+        num = denom = 0;
+        for (std::size_t i{0u}; i < w.size(); ++i)
+        {
+            buffer = w[i];
+            num += buffer * D[i];
+            buffer = w[i] / W[i];
+            if (i % 2 == 0)
+                buffer = -buffer;
+            denom += buffer;
+        }
+        delta = num / denom;
+    }
+
 
     template<typename T>
     void compc(std::vector<T>& C, T& delta,
@@ -118,6 +271,18 @@ namespace pm {
         }
     }
 
+    template<typename T>
+    void compc(std::vector<T>& C, T& delta,
+            std::vector<T>& D, std::vector<T>& W)
+    {
+        T Wi;
+        for (std::size_t i{0u}; i < D.size(); ++i)
+        {
+            Wi = (i % 2 != 0) ? -W[i] : W[i];
+            C[i] = D[i] + (delta / Wi);
+        }
+    }
+
     template<typename T>
     void approx(T& Pc, T const& omega,
             std::vector<T>& x, std::vector<T>& C,
@@ -167,6 +332,271 @@ namespace pm {
         error *= W;
     }
 
+    // number of evaluation points processed together by the batch routines
+    constexpr std::size_t BARY_BLOCK = 8u;
+
+    // computes the numerator and denominator sums of the barycentric formula,
+    // num = sum_j w_j C_j / (t - x_j) and den = sum_j w_j / (t - x_j), for a
+    // block of nt <= BARY_BLOCK points t; hit[k] is set if t[k] is one of the
+    // interpolation nodes (num[k] and den[k] are meaningless in that case)
+    template<typename T>
+    void barysums(T* num, T* den, bool* hit,
+            T const* t, std::size_t nt,
+            std::vector<T> const& x, std::vector<T> const& C,
+            std::vector<T> const& w)
+    {
+        T buff;
+        for (std::size_t k{0u}; k < nt; ++k) {
+            num[k] = den[k] = 0;
+            hit[k] = false;
+        }
+        for (std::size_t j{0u}; j < x.size(); ++j)
+        {
+            for (std::size_t k{0u}; k < nt; ++k)
+            {
+                if (t[k] == x[j]) {
+                    hit[k] = true;
+                    continue;
+                }
+                buff = w[j] / (t[k] - x[j]);
+                num[k] += buff * C[j];
+                den[k] += buff;
+            }
+        }
+    }
+
+    // double precision kernel: the points of a block are spread over the SIMD
+    // lanes and the reference is streamed from its structure-of-arrays storage
+    // (x, C and w); the operations are the same as in the scalar code (no
+    // fused multiply-adds, the file is built with -ffp-contract=off), so
+    // that the results do not depend on the path
+    template<>
+    void barysums<double>(double* num, double* den, bool* hit,
+            double const* t, std::size_t nt,
+            std::vector<double> const& x, std::vector<double> const& C,
+            std::vector<double> const& w)
+    {
+        std::size_t m = x.size();
+        double const* xp = x.data();
+        double const* cp = C.data();
+        double const* wp = w.data();
+#if defined(__AVX512F__)
+        if (nt == 8u) {
+            __m512d zero = _mm512_setzero_pd();
+            __m512d tt = _mm512_loadu_pd(t);
+            __m512d nn = zero, dd = zero;
+            __mmask8 hh = 0;
+            for (std::size_t j{0u}; j < m; ++j)
+            {
+                __m512d diff = _mm512_sub_pd(tt, _mm512_set1_pd(xp[j]));
+                hh |= _mm512_cmp_pd_mask(diff, zero, _CMP_EQ_OQ);
+                __m512d buff = _mm512_div_pd(_mm512_set1_pd(wp[j]), diff);
+                nn = _mm512_add_pd(nn, _mm512_mul_pd(buff, _mm512_set1_pd(cp[j])));
+                dd = _mm512_add_pd(dd, buff);
+            }
+            _mm512_storeu_pd(num, nn);
+            _mm512_storeu_pd(den, dd);
+            for (std::size_t k{0u}; k < 8u; ++k)
+                hit[k] = (hh >> k) & 1u;
+            return;
+        }
+#elif defined(__AVX2__)
+        if (nt == 8u) {
+            __m256d zero = _mm256_setzero_pd();
+            __m256d t0 = _mm256_loadu_pd(t);
+            __m256d t1 = _mm256_loadu_pd(t + 4);
+            __m256d n0 = zero, n1 = zero, d0 = zero, d1 = zero;
+            __m256d h0 = zero, h1 = zero;
+            for (std::size_t j{0u}; j < m; ++j)
+            {
+                __m256d xj = _mm256_set1_pd(xp[j]);
+                __m256d wj = _mm256_set1_pd(wp[j]);
+                __m256d cj = _mm256_set1_pd(cp[j]);
+                __m256d diff0 = _mm256_sub_pd(t0, xj);
+                __m256d diff1 = _mm256_sub_pd(t1, xj);
+                h0 = _mm256_or_pd(h0, _mm256_cmp_pd(diff0, zero, _CMP_EQ_OQ));
+                h1 = _mm256_or_pd(h1, _mm256_cmp_pd(diff1, zero, _CMP_EQ_OQ));
+                __m256d b0 = _mm256_div_pd(wj, diff0);
+                __m256d b1 = _mm256_div_pd(wj, diff1);
+                n0 = _mm256_add_pd(n0, _mm256_mul_pd(b0, cj));
+                n1 = _mm256_add_pd(n1, _mm256_mul_pd(b1, cj));
+                d0 = _mm256_add_pd(d0, b0);
+                d1 = _mm256_add_pd(d1, b1);
+            }
+            _mm256_storeu_pd(num, n0);
+            _mm256_storeu_pd(num + 4, n1);
+            _mm256_storeu_pd(den, d0);
+            _mm256_storeu_pd(den + 4, d1);
+            int hm = _mm256_movemask_pd(h0) | (_mm256_movemask_pd(h1) << 4);
+            for (std::size_t k{0u}; k < 8u; ++k)
+                hit[k] = (hm >> k) & 1;
+            return;
+        }
+#endif
+        // portable version, left to the compiler to vectorize; incomplete
+        // blocks are padded with copies of their first point
+        double tt[BARY_BLOCK], nn[BARY_BLOCK], dd[BARY_BLOCK];
+        int hh[BARY_BLOCK];
+        for (std::size_t k{0u}; k < BARY_BLOCK; ++k) {
+            tt[k] = (k < nt) ? t[k] : t[0];
+            nn[k] = dd[k] = 0.0;
+            hh[k] = 0;
+        }
+        for (std::size_t j{0u}; j < m; ++j)
+        {
+            double xj = xp[j];
+            double wj = wp[j];
+            double cj = cp[j];
+            #pragma omp simd
+            for (std::size_t k = 0u; k < BARY_BLOCK; ++k)
+            {
+                double diff = tt[k] - xj;
+                hh[k] |= (diff == 0.0);
+                double buff = wj / diff;
+                nn[k] += buff * cj;
+                dd[k] += buff;
+            }
+        }
+        for (std::size_t k{0u}; k < nt; ++k) {
+            num[k] = nn[k];
+            den[k] = dd[k];
+            hit[k] = hh[k] != 0;
+        }
+    }
+
+#ifdef HAVE_MPFR
+    // MPFR kernel: the sums and the temporaries are raw numbers from the
+    // scratch arena of the thread, updated in place, so that nothing is
+    // allocated inside the loops (the generic version creates three
+    // temporaries per node and point); the operations and their roundings
+    // are those of the generic version
+    template<>
+    void barysums<mpfr::mpreal>(mpfr::mpreal* num, mpfr::mpreal* den, bool* hit,
+            mpfr::mpreal const* t, std::size_t nt,
+            std::vector<mpfr::mpreal> const& x, std::vector<mpfr::mpreal> const& C,
+            std::vector<mpfr::mpreal> const& w)
+    {
+        mpfr_prec_t prec = mpfr::mpreal::get_default_prec();
+        mpfr_ptr nn = mpfrarena().reserve(2u * nt + 3u, prec);
+        mpfr_ptr dd = nn + nt;
+        mpfr_ptr diff = dd + nt;
+        mpfr_ptr buff = diff + 1;
+        mpfr_ptr prod = diff + 2;
+        for (std::size_t k{0u}; k < nt; ++k)
+            hit[k] = false;
+        for (std::size_t j{0u}; j < x.size(); ++j)
+        {
+            mpfr_srcptr xj = x[j].mpfr_srcptr();
+            mpfr_srcptr wj = w[j].mpfr_srcptr();
+            mpfr_srcptr cj = C[j].mpfr_srcptr();
+            for (std::size_t k{0u}; k < nt; ++k)
+            {
+                mpfr_sub(diff, t[k].mpfr_srcptr(), xj, MPFR_RNDN);
+                if (mpfr_zero_p(diff)) {
+                    hit[k] = true;
+                    continue;
+                }
+                mpfr_div(buff, wj, diff, MPFR_RNDN);
+                mpfr_mul(prod, buff, cj, MPFR_RNDN);
+                mpfr_add(nn + k, nn + k, prod, MPFR_RNDN);
+                mpfr_add(dd + k, dd + k, buff, MPFR_RNDN);
+            }
+        }
+        for (std::size_t k{0u}; k < nt; ++k) {
+            num[k].setPrecision(prec);
+            den[k].setPrecision(prec);
+            mpfr_set(num[k].mpfr_ptr(), nn + k, MPFR_RNDN);
+            mpfr_set(den[k].mpfr_ptr(), dd + k, MPFR_RNDN);
+        }
+    }
+
+    template<>
+    void compdelta<mpfr::mpreal>(mpfr::mpreal& delta, std::vector<mpfr::mpreal>& w,
+            std::vector<mpfr::mpreal>& D, std::vector<mpfr::mpreal>& W)
+    {
+        mpfr_prec_t prec = mpfr::mpreal::get_default_prec();
+        mpfr_ptr num = mpfrarena().reserve(3u, prec);
+        mpfr_ptr denom = num + 1;
+        mpfr_ptr buff = num + 2;
+        for (std::size_t i{0u}; i < w.size(); ++i)
+        {
+            mpfr_mul(buff, w[i].mpfr_srcptr(), D[i].mpfr_srcptr(), MPFR_RNDN);
+            mpfr_add(num, num, buff, MPFR_RNDN);
+            mpfr_div(buff, w[i].mpfr_srcptr(), W[i].mpfr_srcptr(), MPFR_RNDN);
+            if (i % 2 == 0)
+                mpfr_sub(denom, denom, buff, MPFR_RNDN);
+            else
+                mpfr_add(denom, denom, buff, MPFR_RNDN);
+        }
+        delta.setPrecision(prec);
+        mpfr_div(delta.mpfr_ptr(), num, denom, MPFR_RNDN);
+    }
+#endif
+
+    template<typename T>
+    void approx(std::vector<T>& Pc, std::vector<T> const& xVal,
+            std::vector<T>& x, std::vector<T>& C,
+            std::vector<T>& w)
+    {
+        Pc.resize(xVal.size());
+        T num[BARY_BLOCK], den[BARY_BLOCK];
+        bool hit[BARY_BLOCK];
+        for (std::size_t i{0u}; i < xVal.size(); i += BARY_BLOCK)
+        {
+            std::size_t nt = std::min(BARY_BLOCK, xVal.size() - i);
+            barysums(num, den, hit, &xVal[i], nt, x, C, w);
+            for (std::size_t k{0u}; k < nt; ++k)
+            {
+                if (hit[k])
+                    approx(Pc[i + k], xVal[i + k], x, C, w);
+                else
+                    Pc[i + k] = num[k] / den[k];
+            }
+        }
+    }
+
+    template<typename T>
+    void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+            T& delta, std::vector<T>& x,
+            std::vector<T>& C, std::vector<T>& w,
+            std::vector<band_t<T>>& bands)
+    {
+        comperror(error, xVal, delta, x, C, w, bands, bandsorted(bands));
+    }
+
+    template<typename T>
+    void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+            T& delta, std::vector<T>& x,
+            std::vector<T>& C, std::vector<T>& w,
+            std::vector<band_t<T>>& bands, bool sorted)
+    {
+        error.resize(xVal.size());
+        T num[BARY_BLOCK], den[BARY_BLOCK];
+        bool hit[BARY_BLOCK];
+        T D, W;
+        for (std::size_t i{0u}; i < xVal.size(); i += BARY_BLOCK)
+        {
+            std::size_t nt = std::min(BARY_BLOCK, xVal.size() - i);
+            barysums(num, den, hit, &xVal[i], nt, x, C, w);
+            for (std::size_t k{0u}; k < nt; ++k)
+            {
+                if (hit[k]) {
+                    comperror(error[i + k], xVal[i + k], delta, x, C, w, bands);
+                } else {
+                    // points outside of all the bands get a zero error
+                    std::size_t b = bandfind(xVal[i + k], bands, sorted);
+                    if (b < bands.size())
+                        bandvals(D, W, bands[b], xVal[i + k]);
+                    else
+                        D = W = 0;
+                    error[i + k] = num[k] / den[k];
+                    error[i + k] -= D;
+                    error[i + k] *= W;
+                }
+            }
+        }
+    }
+
     /* Template instantiations */
 
     /* double precision */
@@ -184,6 +614,21 @@ namespace pm {
     template void compc<double>(std::vector<double>& C, double& delta,
             std::vector<double>& x, std::vector<band_t<double>>& bands);
 
+    template void compdelta<double>(double& delta, std::vector<double>& w,
+            std::vector<double>& D, std::vector<double>& W);
+
+    template void compc<double>(std::vector<double>& C, double& delta,
+            std::vector<double>& D, std::vector<double>& W);
+
+    template void idealvals<double>(std::vector<double>& D, std::vector<double>& W,
+            std::vector<double> const& x, std::vector<band_t<double>>& bands);
+
+    template void idealvals<double>(std::vector<double>& D, std::vector<double>& W,
+            std::vector<double> const& x, std::vector<band_t<double>>& bands,
+            bool sorted);
+
+    template bool bandsorted<double>(std::vector<band_t<double>> const& bands);
+
     template void approx<double>(double& Pc, double const& xVal,
             std::vector<double>& x, std::vector<double>& C,
             std::vector<double>& w);
@@ -193,6 +638,20 @@ namespace pm {
             std::vector<double>& C, std::vector<double>& w,
             std::vector<band_t<double>>& bands);
 
+    template void approx<double>(std::vector<double>& Pc, std::vector<double> const& xVal,
+            std::vector<double>& x, std::vector<double>& C,
+            std::vector<double>& w);
+
+    template void comperror<double>(std::vector<double>& error, std::vector<double> const& xVal,
+            double& delta, std::vector<double>& x,
+            std::vector<double>& C, std::vector<double>& w,
+            std::vector<band_t<double>>& bands);
+
+    template void comperror<double>(std::vector<double>& error, std::vector<double> const& xVal,
+            double& delta, std::vector<double>& x,
+            std::vector<double>& C, std::vector<double>& w,
+            std::vector<band_t<double>>& bands, bool sorted);
+
     /* long double precision */
 
     template void baryweights<long double>(std::vector<long double>& w,
@@ -206,7 +665,22 @@ namespace pm {
             std::vector<band_t<long double>>& bands);
 
     template void compc<long double>(std::vector<long double>& C, long double& delta,
-            std::vector<long double> &x, std::vector<band_t<long double>>& bands);
+            std::vector<long double>& x, std::vector<band_t<long double>>& bands);
+
+    template void compdelta<long double>(long double& delta, std::vector<long double>& w,
+            std::vector<long double>& D, std::vector<long double>& W);
+
+    template void compc<long double>(std::vector<long double>& C, long double& delta,
+            std::vector<long double>& D, std::vector<long double>& W);
+
+    template void idealvals<long double>(std::vector<long double>& D, std::vector<long double>& W,
+            std::vector<long double> const& x, std::vector<band_t<long double>>& bands);
+
+    template void idealvals<long double>(std::vector<long double>& D, std::vector<long double>& W,
+            std::vector<long double> const& x, std::vector<band_t<long double>>& bands,
+            bool sorted);
+
+    template bool bandsorted<long double>(std::vector<band_t<long double>> const& bands);
 
     template void approx<long double>(long double& Pc, long double const& xVal,
             std::vector<long double>& x, std::vector<long double>& C,
@@ -217,26 +691,217 @@ namespace pm {
             std::vector<long double>& C, std::vector<long double>& w,
             std::vector<band_t<long double>>& bands);
 
+    template void approx<long double>(std::vector<long double>& Pc, std::vector<long double> const& xVal,
+            std::vector<long double>& x, std::vector<long double>& C,
+            std::vector<long double>& w);
+
+    template void comperror<long double>(std::vector<long double>& error, std::vector<long double> const& xVal,
+            long double& delta, std::vector<long double>& x,
+            std::vector<long double>& C, std::vector<long double>& w,
+            std::vector<band_t<long double>>& bands);
+
+    template void comperror<long double>(std::vector<long double>& error, std::vector<long double> const& xVal,
+            long double& delta, std::vector<long double>& x,
+            std::vector<long double>& C, std::vector<long double>& w,
+            std::vector<band_t<long double>>& bands, bool sorted);
+
+/* double-double precision */
+
+    template void baryweights<ddouble>(std::vector<ddouble>& w,
+            std::vector<ddouble>& x);
+
+    template void compdelta<ddouble>(ddouble& delta,
+            std::vector<ddouble>& x, std::vector<band_t<ddouble>>& bands);
+
+    template void compdelta<ddouble>(ddouble& delta,
+            std::vector<ddouble>& w, std::vector<ddouble>& x,
+            std::vector<band_t<ddouble>>& bands);
+
+    template void compc<ddouble>(std::vector<ddouble>& C, ddouble& delta,
+            std::vector<ddouble>& x, std::vector<band_t<ddouble>>& bands);
+
+    template void compdelta<ddouble>(ddouble& delta, std::vector<ddouble>& w,
+            std::vector<ddouble>& D, std::vector<ddouble>& W);
+
+    template void compc<ddouble>(std::vector<ddouble>& C, ddouble& delta,
+            std::vector<ddouble>& D, std::vector<ddouble>& W);
+
+    template void idealvals<ddouble>(std::vector<ddouble>& D, std::vector<ddouble>& W,
+            std::vector<ddouble> const& x, std::vector<band_t<ddouble>>& bands);
+
+    template void idealvals<ddouble>(std::vector<ddouble>& D, std::vector<ddouble>& W,
+            std::vector<ddouble> const& x, std::vector<band_t<ddouble>>& bands,
+            bool sorted);
+
+    template bool bandsorted<ddouble>(std::vector<band_t<ddouble>> const& bands);
+
+    template void approx<ddouble>(ddouble& Pc, ddouble const& xVal,
+            std::vector<ddouble>& x, std::vector<ddouble>& C,
+            std::vector<ddouble>& w);
+
+    template void comperror<ddouble>(ddouble& error, ddouble const& xVal,
+            ddouble& delta, std::vector<ddouble>& x,
+            std::vector<ddouble>& C, std::vector<ddouble>& w,
+            std::vector<band_t<ddouble>>& bands);
+
+    template void approx<ddouble>(std::vector<ddouble>& Pc, std::vector<ddouble> const& xVal,
+            std::vector<ddouble>& x, std::vector<ddouble>& C,
+            std::vector<ddouble>& w);
+
+    template void comperror<ddouble>(std::vector<ddouble>& error, std::vector<ddouble> const& xVal,
+            ddouble& delta, std::vector<ddouble>& x,
+            std::vector<ddouble>& C, std::vector<ddouble>& w,
+            std::vector<band_t<ddouble>>& bands);
+
+    template void comperror<ddouble>(std::vector<ddouble>& error, std::vector<ddouble> const& xVal,
+            ddouble& delta, std::vector<ddouble>& x,
+            std::vector<ddouble>& C, std::vector<ddouble>& w,
+            std::vector<band_t<ddouble>>& bands, bool sorted);
+
+#ifdef HAVE_QUADMATH
+    /* quadruple precision */
+
+    template void baryweights<float128>(std::vector<float128>& w,
+            std::vector<float128>& x);
+
+    template void compdelta<float128>(float128& delta,
+            std::vector<float128>& x, std::vector<band_t<float128>>& bands);
+
+    template void compdelta<float128>(float128& delta,
+            std::vector<float128>& w, std::vector<float128>& x,
+            std::vector<band_t<float128>>& bands);
+
+    template void compc<float128>(std::vector<float128>& C, float128& delta,
+            std::vector<float128>& x, std::vector<band_t<float128>>& bands);
+
+    template void compdelta<float128>(float128& delta, std::vector<float128>& w,
+            std::vector<float128>& D, std::vector<float128>& W);
+
+    template void compc<float128>(std::vector<float128>& C, float128& delta,
+            std::vector<float128>& D, std::vector<float128>& W);
+
+    template void idealvals<float128>(std::vector<float128>& D, std::vector<float128>& W,
+            std::vector<float128> const& x, std::vector<band_t<float128>>& bands);
+
+    template void idealvals<float128>(std::vector<float128>& D, std::vector<float128>& W,
+            std::vector<float128> const& x, std::vector<band_t<float128>>& bands,
+            bool sorted);
+
+    template bool bandsorted<float128>(std::vector<band_t<float128>> const& bands);
+
+    template void approx<float128>(float128& Pc, float128 const& xVal,
+            std::vector<float128>& x, std::vector<float128>& C,
+            std::vector<float128>& w);
+
+    template void comperror<float128>(float128& error, float128 const& xVal,
+            float128& delta, std::vector<float128>& x,
+            std::vector<float128>& C, std::vector<float128>& w,
+            std::vector<band_t<float128>>& bands);
+
+    template void approx<float128>(std::vector<float128>& Pc, std::vector<float128> const& xVal,
+            std::vector<float128>& x, std::vector<float128>& C,
+            std::vector<float128>& w);
+
+    template void comperror<float128>(std::vector<float128>& error, std::vector<float128> const& xVal,
+            float128& delta, std::vector<float128>& x,
+            std::vector<float128>& C, std::vector<float128>& w,
+            std::vector<band_t<float128>>& bands);
+
+    template void comperror<float128>(std::vector<float128>& error, std::vector<float128> const& xVal,
+            float128& delta, std::vector<float128>& x,
+            std::vector<float128>& C, std::vector<float128>& w,
+            std::vector<band_t<float128>>& bands, bool sorted);
+#endif
+
+#ifdef HAVE_BOOST_MP
+    /* octuple precision */
+
+    template void baryweights<float256>(std::vector<float256>& w,
+            std::vector<float256>& x);
+
+    template void compdelta<float256>(float256& delta,
+            std::vector<float256>& x, std::vector<band_t<float256>>& bands);
+
+    template void compdelta<float256>(float256& delta,
+            std::vector<float256>& w, std::vector<float256>& x,
+            std::vector<band_t<float256>>& bands);
+
+    template void compc<float256>(std::vector<float256>& C, float256& delta,
+            std::vector<float256>& x, std::vector<band_t<float256>>& bands);
+
+    template void compdelta<float256>(float256& delta, std::vector<float256>& w,
+            std::vector<float256>& D, std::vector<float256>& W);
+
+    template void compc<float256>(std::vector<float256>& C, float256& delta,
+            std::vector<float256>& D, std::vector<float256>& W);
+
+    template void idealvals<float256>(std::vector<float256>& D, std::vector<float256>& W,
+            std::vector<float256> const& x, std::vector<band_t<float256>>& bands);
+
+    template void idealvals<float256>(std::vector<float256>& D, std::vector<float256>& W,
+            std::vector<float256> const& x, std::vector<band_t<float256>>& bands,
+            bool sorted);
+
+    template bool bandsorted<float256>(std::vector<band_t<float256>> const& bands);
+
+    template void approx<float256>(float256& Pc, float256 const& xVal,
+            std::vector<float256>& x, std::vector<float256>& C,
+            std::vector<float256>& w);
+
+    template void comperror<float256>(float256& error, float256 const& xVal,
+            float256& delta, std::vector<float256>& x,
+            std::vector<float256>& C, std::vector<float256>& w,
+            std::vector<band_t<float256>>& bands);
+
+    template void approx<float256>(std::vector<float256>& Pc, std::vector<float256> const& xVal,
+            std::vector<float256>& x, std::vector<float256>& C,
+            std::vector<float256>& w);
+
+    template void comperror<float256>(std::vector<float256>& error, std::vector<float256> const& xVal,
+            float256& delta, std::vector<float256>& x,
+            std::vector<float256>& C, std::vector<float256>& w,
+            std::vector<band_t<float256>>& bands);
+
+    template void comperror<float256>(std::vector<float256>& error, std::vector<float256> const& xVal,
+            float256& delta, std::vector<float256>& x,
+            std::vector<float256>& C, std::vector<float256>& w,
+            std::vector<band_t<float256>>& bands, bool sorted);
+#endif
+
 #ifdef HAVE_MPFR
     // separate implementation for the MPFR version; it is much faster and
     // the higher precision should usually compensate for any eventual
     // ill-conditioning
+    // (the products are accumulated in place in raw numbers from the scratch
+    // arena of each thread)
     template<> void baryweights<mpfr::mpreal>(std::vector<mpfr::mpreal>& w,
             std::vector<mpfr::mpreal>& x)
     {
         std::size_t step = (x.size() - 2u) / 15 + 1;
-        mpfr::mpreal one = 1u;
-        for(std::size_t i{0u}; i < x.size(); ++i)
+        w.resize(x.size());
+        unsigned long prec = precscope_t<mpfr::mpreal>::current();
+        #pragma omp parallel if(!omp_in_parallel())
         {
-            mpfr::mpreal denom = 1.0;
-            mpfr::mpreal xi = x[i];
-            for(std::size_t j{0u}; j < step; ++j)
+            precscope_t<mpfr::mpreal> scope(prec);
+            mpfr_ptr denom = mpfrarena().reserve(2u, prec);
+            mpfr_ptr diff = denom + 1;
+            #pragma omp for
+            for(std::size_t i = 0u; i < x.size(); ++i)
             {
-                for(std::size_t k{j}; k < x.size(); k += step)
-                    if (k != i)
-                        denom *= ((xi - x[k]) << 1);
+                mpfr_set_ui(denom, 1u, MPFR_RNDN);
+                mpfr_srcptr xi = x[i].mpfr_srcptr();
+                for(std::size_t j{0u}; j < step; ++j)
+                {
+                    for(std::size_t k{j}; k < x.size(); k += step)
+                        if (k != i) {
+                            mpfr_sub(diff, xi, x[k].mpfr_srcptr(), MPFR_RNDN);
+                            mpfr_mul_2ui(diff, diff, 1u, MPFR_RNDN);
+                            mpfr_mul(denom, denom, diff, MPFR_RNDN);
+                        }
+                }
+                w[i].setPrecision(prec);
+                mpfr_ui_div(w[i].mpfr_ptr(), 1u, denom, MPFR_RNDN);
             }
-            w[i] = one / denom;
         }
     }
     template void compdelta<mpfr::mpreal>(mpfr::mpreal& delta,
@@ -249,6 +914,18 @@ namespace pm {
     template void compc<mpfr::mpreal>(std::vector<mpfr::mpreal>& C, mpfr::mpreal& delta,
             std::vector<mpfr::mpreal>& x, std::vector<band_t<mpfr::mpreal>>& bands);
 
+    template void compc<mpfr::mpreal>(std::vector<mpfr::mpreal>& C, mpfr::mpreal& delta,
+            std::vector<mpfr::mpreal>& D, std::vector<mpfr::mpreal>& W);
+
+    template void idealvals<mpfr::mpreal>(std::vector<mpfr::mpreal>& D, std::vector<mpfr::mpreal>& W,
+            std::vector<mpfr::mpreal> const& x, std::vector<band_t<mpfr::mpreal>>& bands);
+
+    template void idealvals<mpfr::mpreal>(std::vector<mpfr::mpreal>& D, std::vector<mpfr::mpreal>& W,
+            std::vector<mpfr::mpreal> const& x, std::vector<band_t<mpfr::mpreal>>& bands,
+            bool sorted);
+
+    template bool bandsorted<mpfr::mpreal>(std::vector<band_t<mpfr::mpreal>> const& bands);
+
     template void approx<mpfr::mpreal>(mpfr::mpreal& Pc, mpfr::mpreal const& xVal,
             std::vector<mpfr::mpreal>& x, std::vector<mpfr::mpreal>& C,
             std::vector<mpfr::mpreal>& w);
@@ -257,6 +934,20 @@ namespace pm {
             mpfr::mpreal& delta, std::vector<mpfr::mpreal>& x,
             std::vector<mpfr::mpreal>& C, std::vector<mpfr::mpreal>& w,
             std::vector<band_t<mpfr::mpreal>>& bands);
+
+    template void approx<mpfr::mpreal>(std::vector<mpfr::mpreal>& Pc, std::vector<mpfr::mpreal> const& xVal,
+            std::vector<mpfr::mpreal>& x, std::vector<mpfr::mpreal>& C,
+            std::vector<mpfr::mpreal>& w);
+
+    template void comperror<mpfr::mpreal>(std::vector<mpfr::mpreal>& error, std::vector<mpfr::mpreal> const& xVal,
+            mpfr::mpreal& delta, std::vector<mpfr::mpreal>& x,
+            std::vector<mpfr::mpreal>& C, std::vector<mpfr::mpreal>& w,
+            std::vector<band_t<mpfr::mpreal>>& bands);
+
+    template void comperror<mpfr::mpreal>(std::vector<mpfr::mpreal>& error, std::vector<mpfr::mpreal> const& xVal,
+            mpfr::mpreal& delta, std::vector<mpfr::mpreal>& x,
+            std::vector<mpfr::mpreal>& C, std::vector<mpfr::mpreal>& w,
+            std::vector<band_t<mpfr::mpreal>>& bands, bool sorted);
 #endif
 
 } // namespace pm
\ No newline at end of file
@@ -0,0 +1,653 @@
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+#include "firpm/cache.h"
+#include "firpm/pmmath.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+namespace pm {
+
+    namespace {
+
+    // name of the working type in the keys (with the precision for MPFR)
+    template<typename T>
+    std::string typetag(unsigned long prec);
+
+    template<> std::string typetag<double>(unsigned long) { return "double"; }
+    template<> std::string typetag<long double>(unsigned long) { return "longdouble"; }
+    template<> std::string typetag<ddouble>(unsigned long) { return "ddouble"; }
+#ifdef HAVE_QUADMATH
+    template<> std::string typetag<float128>(unsigned long) { return "float128"; }
+#endif
+#ifdef HAVE_BOOST_MP
+    template<> std::string typetag<float256>(unsigned long) { return "float256"; }
+#endif
+#ifdef HAVE_MPFR
+    template<> std::string typetag<mpfr::mpreal>(unsigned long prec) {
+        return "mpfr" + std::to_string(prec);
+    }
+#endif
+
+    // decimal digits needed to tell apart any two values of T
+    template<typename T>
+    int valdigits(T const&) { return std::numeric_limits<T>::max_digits10; }
+
+#ifdef HAVE_MPFR
+    template<>
+    int valdigits<mpfr::mpreal>(mpfr::mpreal const& v) {
+        return 2 + (int)(v.getPrecision() * 0.30103);
+    }
+#endif
+
+    template<typename T>
+    void putval(std::ostream& os, T const& v)
+    {
+        os << std::setprecision(valdigits(v)) << v;
+    }
+
+    template<typename T>
+    void putvals(std::ostream& os, char const* name, std::vector<T> const& v)
+    {
+        os << ';' << name << '=';
+        for(std::size_t i{0u}; i < v.size(); ++i) {
+            if(i > 0u)
+                os << ',';
+            putval(os, v[i]);
+        }
+    }
+
+    template<typename T>
+    char const* symtag(pmspec_t<T> const& spec)
+    {
+        if(!spec.antisym)
+            return "sym";
+        return (spec.type == filter_t::FIR_HILBERT) ? "hilbert" : "differentiator";
+    }
+
+    } // anonymous namespace
+
+    template<typename T>
+    std::string speckey(pmspec_t<T> const& spec)
+    {
+        std::ostringstream os;
+        os << "firpm;" << typetag<T>(spec.prec) << ";n=" << spec.n
+            << ';' << symtag(spec) << ";strategy=" << (int)spec.strategy;
+        // the other scaling parameters only matter for the scaling strategy
+        if(spec.strategy == init_t::SCALING)
+            os << ";depth=" << spec.depth << ";rstrategy=" << (int)spec.rstrategy;
+        os << ";eps=" << std::setprecision(17) << spec.eps << ";nmax=" << spec.nmax;
+        // the evaluation of the barycentric formulas changes the result
+        // within the accuracy of the FMM, and the ladder that of the lower
+        // precision iterations
+        os << ";bary=" << (int)spec.opts.bary;
+        if(spec.opts.bary != bary_t::DIRECT)
+            os << ";fmmtol=" << spec.opts.fmmtol;
+        os << ";ladder=" << spec.opts.ladder;
+        putvals(os, "f", spec.f);
+        putvals(os, "a", spec.a);
+        putvals(os, "w", spec.w);
+        return os.str();
+    }
+
+    template<typename T>
+    std::string familykey(pmspec_t<T> const& spec)
+    {
+        std::ostringstream os;
+        os << "firpm;" << typetag<T>(spec.prec) << ";n=" << spec.n
+            << ';' << symtag(spec) << ";bands=" << spec.w.size();
+        return os.str();
+    }
+
+    std::uint64_t fnv1a(std::string const& s)
+    {
+        std::uint64_t h{14695981039346656037ull};
+        for(unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    namespace {
+
+    /* Binary encoding of the cache files: integers and the values of the
+     * trivially copyable types are stored as they are in memory, those of
+     * the other types (Boost and MPFR numbers) as text with all their
+     * digits, preceded by its length. */
+
+    // bytes of a value of T that hold its value: the x87 extended format
+    // of long double only uses 10 of them, the others are padding
+    template<typename T>
+    constexpr std::size_t valsize()
+    {
+        return (std::is_same<T, long double>::value &&
+                std::numeric_limits<long double>::digits == 64) ? 10u : sizeof(T);
+    }
+
+    template<typename T>
+    void putraw(std::string& buf, T const& v)
+    {
+        buf.append(reinterpret_cast<char const*>(&v), sizeof(T));
+    }
+
+    void putstr(std::string& buf, std::string const& s)
+    {
+        putraw(buf, (std::uint32_t)s.size());
+        buf.append(s);
+    }
+
+    template<typename T>
+    void putnum(std::string& buf, T const& v, std::true_type)
+    {
+        buf.append(reinterpret_cast<char const*>(&v), valsize<T>());
+    }
+
+    template<typename T>
+    void putnum(std::string& buf, T const& v, std::false_type)
+    {
+        std::ostringstream os;
+        putval(os, v);
+        putstr(buf, os.str());
+    }
+
+    template<typename T>
+    void putvec(std::string& buf, std::vector<T> const& v)
+    {
+        putraw(buf, (std::uint64_t)v.size());
+        for(auto const& it : v)
+            putnum(buf, it, std::is_trivially_copyable<T>{});
+    }
+
+    struct reader_t {
+        std::string const& buf;
+        std::size_t pos;
+
+        bool raw(void* p, std::size_t n) {
+            if(buf.size() - pos < n)
+                return false;
+            std::memcpy(p, buf.data() + pos, n);
+            pos += n;
+            return true;
+        }
+
+        bool str(std::string& s) {
+            std::uint32_t n;
+            if(!raw(&n, sizeof(n)) || buf.size() - pos < n)
+                return false;
+            s.assign(buf, pos, n);
+            pos += n;
+            return true;
+        }
+    };
+
+    template<typename T>
+    bool getnum(reader_t& r, T& v, std::true_type)
+    {
+        v = T();
+        return r.raw(&v, valsize<T>());
+    }
+
+    template<typename T>
+    bool getnum(reader_t& r, T& v, std::false_type)
+    {
+        std::string s;
+        if(!r.str(s))
+            return false;
+        std::istringstream is(s);
+        is >> v;
+        return !is.fail();
+    }
+
+    template<typename T>
+    bool getvec(reader_t& r, std::vector<T>& v)
+    {
+        std::uint64_t n;
+        // every value takes at least one byte, which bounds the size of a
+        // vector read from a damaged file
+        if(!r.raw(&n, sizeof(n)) || n > r.buf.size() - r.pos)
+            return false;
+        v.resize(n);
+        for(auto& it : v)
+            if(!getnum(r, it, std::is_trivially_copyable<T>{}))
+                return false;
+        return true;
+    }
+
+    bool readfile(std::string const& path, std::string& buf)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if(!in)
+            return false;
+        std::streamoff size = in.tellg();
+        if(size <= 0)
+            return false;
+        buf.resize(size);
+        in.seekg(0);
+        return (bool)in.read(&buf[0], size);
+    }
+
+    // the file is written next to its final location and renamed into
+    // place, which replaces any previous version atomically
+    void writefile(std::string const& path, std::string const& buf)
+    {
+        static thread_local std::mt19937_64 gen{std::random_device{}() ^
+            (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() ^
+            std::hash<std::thread::id>{}(std::this_thread::get_id())};
+        std::ostringstream tmp;
+        tmp << path << ".tmp" << std::hex << gen();
+        {
+            std::ofstream out(tmp.str(), std::ios::binary | std::ios::trunc);
+            out.write(buf.data(), buf.size());
+            out.close();
+            if(!out) {
+                std::remove(tmp.str().c_str());
+                return;
+            }
+        }
+        if(std::rename(tmp.str().c_str(), path.c_str()) != 0)
+            std::remove(tmp.str().c_str());
+    }
+
+    std::string cachepath(std::string const& dir, std::string const& key,
+            char const* ext)
+    {
+        std::ostringstream os;
+        os << dir << '/' << std::hex << std::setw(16) << std::setfill('0')
+            << fnv1a(key) << '.' << ext;
+        return os.str();
+    }
+
+    // magic numbers of the design and family files
+    char const DESIGN_MAGIC[] = "PMC2";
+    char const FAMILY_MAGIC[] = "PMF2";
+
+    // saves x as the latest reference of the family of spec
+    template<typename T>
+    void putfamily(std::string const& dir, pmspec_t<T> const& spec,
+            std::vector<T> const& x)
+    {
+        std::string fkey = familykey(spec);
+        std::string buf;
+        buf.append(FAMILY_MAGIC, 4u);
+        putstr(buf, fkey);
+        putvec(buf, x);
+        writefile(cachepath(dir, fkey, "pmf"), buf);
+    }
+
+    // memory taken by a value of type T (the MPFR numbers keep their
+    // significand outside of the object)
+    template<typename T>
+    std::size_t valbytes(T const&) { return sizeof(T); }
+
+#ifdef HAVE_MPFR
+    template<>
+    std::size_t valbytes<mpfr::mpreal>(mpfr::mpreal const& v) {
+        return sizeof(mpfr::mpreal) + (v.getPrecision() + 63) / 64 * 8;
+    }
+#endif
+
+    template<typename T>
+    std::size_t outputbytes(std::string const& key, pmoutput_t<T> const& output)
+    {
+        std::size_t bytes = sizeof(pmoutput_t<T>) + key.size();
+        if(!output.h.empty())
+            bytes += output.h.size() * valbytes(output.h[0]);
+        if(!output.x.empty())
+            bytes += output.x.size() * valbytes(output.x[0]);
+        return bytes;
+    }
+
+    // interval at which a request waiting for the design of another thread
+    // checks its own cancellation flag
+    constexpr std::chrono::milliseconds COALESCE_POLL{10};
+
+    // waits for the design of another thread, within the deadline and
+    // cancellation flag of the waiting request; true if that design
+    // finished and succeeded
+    template<typename T>
+    bool awaitdesign(std::shared_future<pmoutput_t<T>> const& inflight,
+            pmopts_t<T> const& opts)
+    {
+        for(;;) {
+            if(opts.cancel && opts.cancel->load(std::memory_order_relaxed))
+                return false;
+            auto until = std::min(opts.deadline,
+                    std::chrono::steady_clock::now() + COALESCE_POLL);
+            if(inflight.wait_until(until) == std::future_status::ready)
+                break;
+            if(std::chrono::steady_clock::now() >= opts.deadline)
+                return false;
+        }
+        try {
+            return inflight.get().status == status_t::STATUS_SUCCESS;
+        } catch(...) {
+            return false;
+        }
+    }
+
+    } // anonymous namespace
+
+    template<typename T>
+    diskcache_t<T>::diskcache_t(std::string dir) : dir{std::move(dir)} {}
+
+    template<typename T>
+    bool diskcache_t<T>::lookup(pmspec_t<T> const& spec,
+            pmoutput_t<T>& output) const
+    {
+        if(!spec.opts.x0.empty())
+            return false;
+        std::string key = speckey(spec);
+        std::string buf;
+        if(!readfile(cachepath(dir, key, "pmc"), buf))
+            return false;
+
+        // the values are read in the precision of the design
+        precscope_t<T> scope(spec.prec);
+        reader_t r{buf, 0u};
+        char magic[4];
+        std::string fkey;
+        if(!r.raw(magic, 4u) || std::memcmp(magic, DESIGN_MAGIC, 4u) != 0 ||
+                !r.str(fkey) || fkey != key)
+            return false;
+        pmoutput_t<T> cached;
+        std::uint64_t iter;
+        std::int32_t status;
+        if(!r.raw(&iter, sizeof(iter)) || !r.raw(&status, sizeof(status)) ||
+                !getnum(r, cached.delta, std::is_trivially_copyable<T>{}) ||
+                !getnum(r, cached.q, std::is_trivially_copyable<T>{}) ||
+                !getvec(r, cached.x) || !getvec(r, cached.h))
+            return false;
+        cached.iter = iter;
+        cached.status = (status_t)status;
+        output = std::move(cached);
+        return true;
+    }
+
+    template<typename T>
+    void diskcache_t<T>::store(pmspec_t<T> const& spec,
+            pmoutput_t<T> const& output) const
+    {
+        if(output.status != status_t::STATUS_SUCCESS || !spec.opts.x0.empty())
+            return;
+        std::string key = speckey(spec);
+        std::string buf;
+        buf.append(DESIGN_MAGIC, 4u);
+        putstr(buf, key);
+        putraw(buf, (std::uint64_t)output.iter);
+        putraw(buf, (std::int32_t)output.status);
+        putnum(buf, output.delta, std::is_trivially_copyable<T>{});
+        putnum(buf, output.q, std::is_trivially_copyable<T>{});
+        putvec(buf, output.x);
+        putvec(buf, output.h);
+        writefile(cachepath(dir, key, "pmc"), buf);
+        putfamily(dir, spec, output.x);
+    }
+
+    template<typename T>
+    bool diskcache_t<T>::nearest(pmspec_t<T> const& spec,
+            std::vector<T>& x) const
+    {
+        std::string fkey = familykey(spec);
+        std::string buf;
+        if(!readfile(cachepath(dir, fkey, "pmf"), buf))
+            return false;
+
+        precscope_t<T> scope(spec.prec);
+        reader_t r{buf, 0u};
+        char magic[4];
+        std::string key;
+        std::vector<T> cached;
+        if(!r.raw(magic, 4u) || std::memcmp(magic, FAMILY_MAGIC, 4u) != 0 ||
+                !r.str(key) || key != fkey || !getvec(r, cached) || cached.empty())
+            return false;
+        x = std::move(cached);
+        return true;
+    }
+
+    template<typename T>
+    pmoutput_t<T> diskcache_t<T>::firpm(pmspec_t<T> const& spec) const
+    {
+        // designs with their own starting reference are not cached
+        if(!spec.opts.x0.empty())
+            return firpmspec(spec);
+        pmoutput_t<T> output;
+        if(lookup(spec, output))
+            return output;
+
+        pmspec_t<T> wspec{spec};
+        if(nearest(spec, wspec.opts.x0)) {
+            wspec.opts.x0space = space_t::CHEBY;
+            output = firpmspec(wspec);
+            // a warm start may change the result within the convergence
+            // threshold: only its reference is kept, for the family
+            if(output.status == status_t::STATUS_SUCCESS) {
+                putfamily(dir, spec, output.x);
+                return output;
+            }
+            // the reference of the family may be a poor start after all
+        }
+        output = firpmspec(spec);
+        store(spec, output);
+        return output;
+    }
+
+    template<typename T>
+    memcache_t<T>::memcache_t(std::size_t maxbytes, std::size_t nshards)
+        : maxbytes{maxbytes / std::max<std::size_t>(nshards, 1u)}
+    {
+        shards.resize(std::max<std::size_t>(nshards, 1u));
+        for(auto& it : shards)
+            it.reset(new shard_t);
+    }
+
+    template<typename T>
+    typename memcache_t<T>::shard_t& memcache_t<T>::shard(std::string const& key)
+    {
+        return *shards[std::hash<std::string>{}(key) % shards.size()];
+    }
+
+    template<typename T>
+    void memcache_t<T>::insert(shard_t& s, std::string const& key,
+            pmoutput_t<T> const& output)
+    {
+        if(output.status != status_t::STATUS_SUCCESS)
+            return;
+        std::size_t bytes = outputbytes(key, output);
+        if(bytes > maxbytes)
+            return;
+        auto it = s.index.find(key);
+        if(it != s.index.end()) {
+            s.bytes -= it->second->bytes;
+            s.lru.erase(it->second);
+            s.index.erase(it);
+        }
+        while(!s.lru.empty() && s.bytes + bytes > maxbytes) {
+            s.bytes -= s.lru.back().bytes;
+            s.index.erase(s.lru.back().key);
+            s.lru.pop_back();
+            ++evictions;
+        }
+        s.lru.push_front(entry_t{key,
+                std::make_shared<pmoutput_t<T> const>(output), bytes});
+        s.index[key] = s.lru.begin();
+        s.bytes += bytes;
+    }
+
+    template<typename T>
+    bool memcache_t<T>::lookup(pmspec_t<T> const& spec, pmoutput_t<T>& output)
+    {
+        if(!spec.opts.x0.empty())
+            return false;
+        std::string key = speckey(spec);
+        shard_t& s = shard(key);
+        std::shared_ptr<pmoutput_t<T> const> cached;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.index.find(key);
+            if(it == s.index.end()) {
+                ++misses;
+                return false;
+            }
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            cached = it->second->output;
+        }
+        ++hits;
+        // the copy is made outside of the lock
+        output = *cached;
+        return true;
+    }
+
+    template<typename T>
+    void memcache_t<T>::store(pmspec_t<T> const& spec, pmoutput_t<T> const& output)
+    {
+        if(!spec.opts.x0.empty())
+            return;
+        std::string key = speckey(spec);
+        shard_t& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        insert(s, key, output);
+    }
+
+    template<typename T>
+    pmoutput_t<T> memcache_t<T>::firpm(pmspec_t<T> const& spec)
+    {
+        // designs with their own starting reference are not cached
+        if(!spec.opts.x0.empty())
+            return firpmspec(spec);
+        std::string key = speckey(spec);
+        shard_t& s = shard(key);
+        std::shared_ptr<pmoutput_t<T> const> cached;
+        std::shared_future<pmoutput_t<T>> inflight;
+        std::promise<pmoutput_t<T>> promise;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.index.find(key);
+            if(it != s.index.end()) {
+                s.lru.splice(s.lru.begin(), s.lru, it->second);
+                cached = it->second->output;
+            } else {
+                auto pit = s.pending.find(key);
+                if(pit != s.pending.end())
+                    inflight = pit->second;
+                else
+                    s.pending.emplace(key, promise.get_future().share());
+            }
+        }
+        if(cached) {
+            ++hits;
+            return *cached;
+        }
+        if(inflight.valid()) {
+            ++coalesced;
+            if(awaitdesign(inflight, spec.opts))
+                return inflight.get();
+            // the other thread was stopped by its own controls or failed, or
+            // this request ran out of time: the design is done here, under
+            // the controls of this request
+            ++misses;
+            pmoutput_t<T> output = firpmspec(spec);
+            std::lock_guard<std::mutex> lock(s.mutex);
+            insert(s, key, output);
+            return output;
+        }
+
+        ++misses;
+        pmoutput_t<T> output;
+        try {
+            output = firpmspec(spec);
+        } catch(...) {
+            // the waiting threads get the exception too
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.pending.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.pending.erase(key);
+            insert(s, key, output);
+        }
+        promise.set_value(output);
+        return output;
+    }
+
+    template<typename T>
+    cachestats_t memcache_t<T>::stats() const
+    {
+        cachestats_t st{hits, misses, coalesced, evictions, 0u, 0u};
+        for(auto const& it : shards) {
+            std::lock_guard<std::mutex> lock(it->mutex);
+            st.entries += it->lru.size();
+            st.bytes += it->bytes;
+        }
+        return st;
+    }
+
+    template<typename T>
+    void memcache_t<T>::clear()
+    {
+        for(auto& it : shards) {
+            std::lock_guard<std::mutex> lock(it->mutex);
+            it->lru.clear();
+            it->index.clear();
+            it->bytes = 0u;
+        }
+    }
+
+    /* Explicit instantiations, since template code is not in header */
+
+    /* double precision */
+    template std::string speckey<double>(pmspec_t<double> const& spec);
+    template std::string familykey<double>(pmspec_t<double> const& spec);
+    template class diskcache_t<double>;
+    template class memcache_t<double>;
+
+    /* long double precision */
+    template std::string speckey<long double>(pmspec_t<long double> const& spec);
+    template std::string familykey<long double>(pmspec_t<long double> const& spec);
+    template class diskcache_t<long double>;
+    template class memcache_t<long double>;
+
+    /* double-double precision */
+    template std::string speckey<ddouble>(pmspec_t<ddouble> const& spec);
+    template std::string familykey<ddouble>(pmspec_t<ddouble> const& spec);
+    template class diskcache_t<ddouble>;
+    template class memcache_t<ddouble>;
+
+#ifdef HAVE_QUADMATH
+    /* quadruple precision */
+    template std::string speckey<float128>(pmspec_t<float128> const& spec);
+    template std::string familykey<float128>(pmspec_t<float128> const& spec);
+    template class diskcache_t<float128>;
+    template class memcache_t<float128>;
+#endif
+
+#ifdef HAVE_BOOST_MP
+    /* octuple precision */
+    template std::string speckey<float256>(pmspec_t<float256> const& spec);
+    template std::string familykey<float256>(pmspec_t<float256> const& spec);
+    template class diskcache_t<float256>;
+    template class memcache_t<float256>;
+#endif
+
+/* multiple precision mpreal */
+#ifdef HAVE_MPFR
+    template std::string speckey<mpfr::mpreal>(pmspec_t<mpfr::mpreal> const& spec);
+    template std::string familykey<mpfr::mpreal>(pmspec_t<mpfr::mpreal> const& spec);
+    template class diskcache_t<mpfr::mpreal>;
+    template class memcache_t<mpfr::mpreal>;
+#endif
+
+} // namespace pm
@@ -3,14 +3,21 @@
 
 #include "firpm/cheby.h"
 #include "firpm/pmmath.h"
+#include "firpm/mpfrarena.h"
+#include <list>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <tuple>
 
 namespace pm {
 
     template<typename T>
     using MatrixXd = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
 
-    template<typename T>
-    using VectorXcd = Eigen::Matrix<std::complex<T>, Eigen::Dynamic, 1>;
+    // sizes above which chebcoeffs switches from the O(n^2) Clenshaw sums
+    // to the FFT-based DCT
+    constexpr std::size_t CHEBCOEFFS_FFT_THRESHOLD = 128u;
 
     template<typename T>
     void balance(MatrixXd<T>& A)
@@ -178,6 +185,44 @@ namespace pm {
             result = (x * 2) * bn1 - bn2 + p[0];
     }
 
+#ifdef HAVE_MPFR
+    // MPFR version of the recurrence, on raw numbers from the scratch arena
+    // of the thread that are updated in place (the generic version creates
+    // three temporaries per coefficient, with the same roundings)
+    template<>
+    void clenshaw<mpfr::mpreal>(mpfr::mpreal& result,
+                std::vector<mpfr::mpreal> const& p,
+                mpfr::mpreal const& x,
+                chebkind_t kind)
+    {
+        mpfr_prec_t prec = mpfr::mpreal::get_default_prec();
+        mpfr_ptr bn = mpfrarena().reserve(4u, prec);
+        mpfr_ptr bn1 = bn + 1;
+        mpfr_ptr bn2 = bn + 2;
+        mpfr_ptr x2 = bn + 3;
+
+        int n = (int)p.size() - 1;
+        mpfr_mul_2ui(x2, x.mpfr_srcptr(), 1u, MPFR_RNDN);
+        mpfr_set(bn1, p[n].mpfr_srcptr(), MPFR_RNDN);
+        for(int k{n - 1}; k >= 1; --k) {
+            // bn = 2x * bn1 - bn2 + p[k], then shift the three values
+            mpfr_mul(bn, x2, bn1, MPFR_RNDN);
+            mpfr_sub(bn, bn, bn2, MPFR_RNDN);
+            mpfr_add(bn, bn, p[k].mpfr_srcptr(), MPFR_RNDN);
+            mpfr_swap(bn2, bn1);
+            mpfr_swap(bn1, bn);
+        }
+
+        if(kind == FIRST)
+            mpfr_mul(bn, x.mpfr_srcptr(), bn1, MPFR_RNDN);
+        else
+            mpfr_mul(bn, x2, bn1, MPFR_RNDN);
+        mpfr_sub(bn, bn, bn2, MPFR_RNDN);
+        result.setPrecision(prec);
+        mpfr_add(result.mpfr_ptr(), bn, p[0].mpfr_srcptr(), MPFR_RNDN);
+    }
+#endif
+
     template<typename T>
     void equipts(std::vector<T>& v, std::size_t n)
     {
@@ -190,6 +235,249 @@ namespace pm {
         }
     }
 
+    // precision component of the chebpts cache keys (only relevant
+    // for the MPFR type)
+    template<typename T>
+    long chebprec() { return 0l; }
+
+#ifdef HAVE_MPFR
+    template<>
+    long chebprec<mpfr::mpreal>() { return mpfr::mpreal::get_default_prec(); }
+#endif
+
+    // node sets of the chebpts cache, most recently used first; the least
+    // recently used ones are dropped once the cache holds more than
+    // CHEBPTS_CACHE_SIZE nodes
+    template<typename T>
+    struct chebcache_t {
+        using key_t = std::tuple<std::size_t, int, long>;
+        using entry_t = std::pair<key_t, std::shared_ptr<const std::vector<T>>>;
+        std::mutex lock;
+        std::atomic<unsigned long> generation{0ul};
+        std::list<entry_t> lru;
+        std::map<key_t, typename std::list<entry_t>::iterator> nodes;
+        std::size_t size{0u};   // number of nodes in the cache
+    };
+
+    template<typename T>
+    chebcache_t<T>& chebcache()
+    {
+        static chebcache_t<T> cache;
+        return cache;
+    }
+
+    template<typename T>
+    std::shared_ptr<const std::vector<T>> chebpts(std::size_t n,
+            chebkind_t kind)
+    {
+        using key_t = typename chebcache_t<T>::key_t;
+        chebcache_t<T>& cache = chebcache<T>();
+        key_t key{n, (int)kind, chebprec<T>()};
+
+        // most lookups come in long runs with the same key (e.g., one per
+        // subinterval during an iteration), so keep the last node set of
+        // each thread around and skip the lock in that case
+        static thread_local key_t lastKey;
+        static thread_local unsigned long lastGeneration{0ul};
+        static thread_local std::shared_ptr<const std::vector<T>> last;
+        unsigned long generation = cache.generation.load();
+        if(last && lastKey == key && lastGeneration == generation)
+            return last;
+
+        std::shared_ptr<const std::vector<T>> result;
+        {
+            std::lock_guard<std::mutex> guard(cache.lock);
+            auto it = cache.nodes.find(key);
+            if(it != cache.nodes.end()) {
+                cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+                result = it->second->second;
+            }
+        }
+        if(!result) {
+            // compute outside of the lock; if another thread inserted the
+            // same nodes in the meantime, use its copy
+            auto v = std::make_shared<std::vector<T>>(n);
+            if(kind == SECOND) {
+                equipts(*v, n);
+            } else {
+                for(std::size_t i{0u}; i < n; ++i) {
+                    (*v)[i] = pmmath::const_pi<T>() * (2u * i + 1u);
+                    (*v)[i] /= (2u * n);
+                }
+            }
+            cos(*v, *v);
+            std::lock_guard<std::mutex> guard(cache.lock);
+            auto it = cache.nodes.find(key);
+            if(it != cache.nodes.end()) {
+                cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+                result = it->second->second;
+            } else {
+                cache.lru.emplace_front(key, v);
+                cache.nodes.emplace(key, cache.lru.begin());
+                cache.size += n;
+                // the node sets still used by a caller stay valid
+                while(cache.size > CHEBPTS_CACHE_SIZE && cache.lru.size() > 1u) {
+                    cache.size -= cache.lru.back().second->size();
+                    cache.nodes.erase(cache.lru.back().first);
+                    cache.lru.pop_back();
+                }
+                result = v;
+            }
+        }
+
+        lastKey = key;
+        lastGeneration = generation;
+        last = result;
+        return result;
+    }
+
+    template<typename T>
+    void chebptsclear()
+    {
+        chebcache_t<T>& cache = chebcache<T>();
+        std::lock_guard<std::mutex> guard(cache.lock);
+        cache.nodes.clear();
+        cache.lru.clear();
+        cache.size = 0u;
+        ++cache.generation;
+    }
+
+    // in-place radix-2 FFT of the sequence re + i * im (its size must be a
+    // power of two); the real and imaginary parts are kept in separate
+    // arrays so that the same code works for all the supported types
+    template<typename T>
+    void fft2(std::vector<T>& re, std::vector<T>& im, bool inverse)
+    {
+        std::size_t n = re.size();
+        for(std::size_t i{1u}, j{0u}; i < n; ++i) {
+            std::size_t bit = n >> 1u;
+            for(; j & bit; bit >>= 1u)
+                j ^= bit;
+            j ^= bit;
+            if(i < j) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+
+        // twiddle factors exp(-+2 * pi * i * k / n), computed directly
+        // (and not by recurrence) to keep them accurate
+        std::vector<T> wr(n / 2u), wi(n / 2u);
+        for(std::size_t k{0u}; k < n / 2u; ++k) {
+            T angle = pmmath::const_pi<T>() * (2u * k);
+            angle /= n;
+            wr[k] = pmmath::cos(angle);
+            wi[k] = inverse ? pmmath::sin(angle) : -pmmath::sin(angle);
+        }
+
+        T xr, xi;
+        for(std::size_t len{2u}; len <= n; len <<= 1u) {
+            std::size_t half = len / 2u;
+            std::size_t step = n / len;
+            for(std::size_t i{0u}; i < n; i += len) {
+                for(std::size_t j{0u}; j < half; ++j) {
+                    std::size_t u = i + j;
+                    std::size_t v = u + half;
+                    T const& cr = wr[j * step];
+                    T const& ci = wi[j * step];
+                    xr = re[v] * cr - im[v] * ci;
+                    xi = re[v] * ci + im[v] * cr;
+                    re[v] = re[u] - xr;
+                    im[v] = im[u] - xi;
+                    re[u] += xr;
+                    im[u] += xi;
+                }
+            }
+        }
+    }
+
+    // forward DFT of arbitrary length: radix-2 when the length is a power
+    // of two, Bluestein's algorithm (a chirp convolution done with radix-2
+    // transforms) otherwise
+    template<typename T>
+    void fft(std::vector<T>& re, std::vector<T>& im)
+    {
+        std::size_t l = re.size();
+        if((l & (l - 1u)) == 0u) {
+            fft2(re, im, false);
+            return;
+        }
+
+        std::size_t m{1u};
+        while(m < 2u * l - 1u)
+            m <<= 1u;
+
+        // chirp exp(i * pi * k^2 / l), with k^2 reduced modulo 2l
+        std::vector<T> cr(l), ci(l);
+        for(std::size_t k{0u}; k < l; ++k) {
+            T angle = pmmath::const_pi<T>() * ((k * k) % (2u * l));
+            angle /= l;
+            cr[k] = pmmath::cos(angle);
+            ci[k] = pmmath::sin(angle);
+        }
+
+        std::vector<T> ar(m), ai(m), br(m), bi(m);
+        for(std::size_t k{0u}; k < m; ++k)
+            ar[k] = ai[k] = br[k] = bi[k] = 0;
+        for(std::size_t k{0u}; k < l; ++k) {
+            // a_k = x_k * conj(chirp_k)
+            ar[k] = re[k] * cr[k] + im[k] * ci[k];
+            ai[k] = im[k] * cr[k] - re[k] * ci[k];
+        }
+        br[0] = cr[0];
+        bi[0] = ci[0];
+        for(std::size_t k{1u}; k < l; ++k) {
+            br[k] = br[m - k] = cr[k];
+            bi[k] = bi[m - k] = ci[k];
+        }
+
+        fft2(ar, ai, false);
+        fft2(br, bi, false);
+        T tr;
+        for(std::size_t k{0u}; k < m; ++k) {
+            tr = ar[k] * br[k] - ai[k] * bi[k];
+            ai[k] = ar[k] * bi[k] + ai[k] * br[k];
+            ar[k] = tr;
+        }
+        fft2(ar, ai, true);
+
+        // X_k = conj(chirp_k) * (a * b)_k / m
+        for(std::size_t k{0u}; k < l; ++k) {
+            ar[k] /= m;
+            ai[k] /= m;
+            re[k] = ar[k] * cr[k] + ai[k] * ci[k];
+            im[k] = ai[k] * cr[k] - ar[k] * ci[k];
+        }
+    }
+
+    // coefficients of the CI from its values at the n Chebyshev nodes of the
+    // second kind, obtained as a DCT-I computed with an FFT of the even
+    // extension of fv (of size 2(n-1))
+    template<typename T>
+    void chebcoeffsfft(std::vector<T>& c,
+            std::vector<T> const& fv)
+    {
+        std::size_t n = fv.size();
+        std::size_t N = n - 1u;
+        std::vector<T> re(2u * N), im(2u * N);
+        for(std::size_t j{0u}; j <= N; ++j)
+            re[j] = fv[j];
+        for(std::size_t j{1u}; j < N; ++j)
+            re[2u * N - j] = fv[j];
+        for(std::size_t j{0u}; j < 2u * N; ++j)
+            im[j] = 0;
+
+        fft(re, im);
+
+        for(std::size_t i{0u}; i < n; ++i) {
+            c[i] = re[i];
+            if(i == 0u || i == N)
+                c[i] /= 2u * N;
+            else
+                c[i] /= N;
+        }
+    }
+
     // this function computes the values of the coefficients of 
     // the CI when Chebyshev nodes of the second kind are used
     template<typename T>
@@ -197,10 +485,11 @@ namespace pm {
             std::vector<T>& fv)
     {
         std::size_t n = fv.size();
-        std::vector<T> v(n);
-        equipts(v, n);
-
-        T buffer;
+        if(n > CHEBCOEFFS_FFT_THRESHOLD) {
+            chebcoeffsfft(c, fv);
+            return;
+        }
+        std::shared_ptr<const std::vector<T>> v = chebpts<T>(n);
 
         // halve the first and last coefficients
         T oldValue1 = fv[0];
@@ -211,8 +500,7 @@ namespace pm {
         for(std::size_t i{0u}; i < n; ++i) {
             // compute the actual value at the Chebyshev
             // node cos(i * pi / n)
-            buffer = pmmath::cos(v[i]);
-            clenshaw(c[i], fv, buffer, FIRST);
+            clenshaw(c[i], fv, (*v)[i], FIRST);
 
             if(i == 0u || i == n-1u) {
                 c[i] /= (n-1u);
@@ -255,6 +543,123 @@ namespace pm {
         }
     }
 
+    // degree above which roots() splits the domain instead of solving a
+    // single large eigenvalue problem
+    constexpr std::size_t ROOTS_SPLIT_DEGREE = 50u;
+    // maximum number of subdivision levels
+    constexpr std::size_t ROOTS_MAX_DEPTH = 8u;
+
+    // real eigenvalues of the colleague matrix lying inside (lo, hi); the
+    // transpose of the colleague matrix is upper Hessenberg (balancing is
+    // a diagonal similarity, so it keeps that structure), which means that
+    // the Hessenberg reduction of a general eigensolver can be skipped and
+    // that only the quasi-triangular Schur factor needs to be formed
+    template<typename T>
+    void colleagueeigs(std::vector<T>& r, std::vector<T> const& c,
+            chebkind_t kind, bool balance,
+            T const& lo, T const& hi)
+    {
+        MatrixXd<T> H = colleague(c, kind, balance).transpose();
+        Eigen::RealSchur<MatrixXd<T>> schur(H.rows());
+        schur.computeFromHessenberg(H, MatrixXd<T>(), false);
+        MatrixXd<T> const& S = schur.matrixT();
+
+        T threshold = 1e-20;
+        Eigen::Index n = S.rows();
+        Eigen::Index i{0};
+        while(i < n) {
+            if(i == n - 1 || S(i + 1, i) == 0) {
+                if(lo < S(i, i) && hi > S(i, i))
+                    r.push_back(S(i, i));
+                ++i;
+            } else {
+                // 2x2 diagonal block, usually a complex conjugate pair
+                T p = (S(i, i) - S(i + 1, i + 1)) / 2;
+                T q = p * p + S(i + 1, i) * S(i, i + 1);
+                T z = pmmath::sqrt(pmmath::fabs(q));
+                T re = S(i + 1, i + 1) + p;
+                if(q >= 0) {
+                    if(lo < re - z && hi > re - z)
+                        r.push_back(re - z);
+                    if(lo < re + z && hi > re + z)
+                        r.push_back(re + z);
+                } else if(z < threshold && lo < re && hi > re) {
+                    r.push_back(re);
+                }
+                i += 2;
+            }
+        }
+    }
+
+    // roots of a CI of large degree: the CI is resampled on the two parts of
+    // [-1, 1] separated by a point slightly off the center (so that it does
+    // not fall on a likely root), the resulting interpolants are chopped and
+    // their roots are computed recursively
+    template<typename T>
+    void splitroots(std::vector<T>& r, std::vector<T> const& c,
+            chebkind_t kind, bool balance, std::size_t depth)
+    {
+        // the local roots are accepted slightly outside [-1, 1] so that
+        // those close to a split point are not lost; duplicates are
+        // removed by the caller
+        T eps = pmmath::epsilon<T>();
+        T lo = -1 - pmmath::sqrt(eps);
+        T hi = 1 + pmmath::sqrt(eps);
+
+        std::size_t n = c.size() - 1u;
+        if(n <= ROOTS_SPLIT_DEGREE || depth == ROOTS_MAX_DEPTH) {
+            colleagueeigs(r, c, kind, balance, lo, hi);
+            return;
+        }
+
+        T chop = 0;
+        for(auto& it : c)
+            chop += pmmath::fabs(it);
+        chop *= eps;
+
+        std::shared_ptr<const std::vector<T>> nodes = chebpts<T>(n + 1u);
+        T split = -0.004849834917525;
+        T bounds[3] = {T(-1), split, T(1)};
+        std::vector<T> x, fv, lc[2];
+        for(std::size_t k{0u}; k < 2u; ++k) {
+            chgvar(x, *nodes, bounds[k], bounds[k + 1u]);
+            fv.resize(x.size());
+            for(std::size_t i{0u}; i < x.size(); ++i)
+                clenshaw(fv[i], c, x[i], kind);
+            lc[k].resize(fv.size());
+            chebcoeffs(lc[k], fv);
+
+            // drop the trailing coefficients that are at the level of the
+            // rounding errors made when evaluating the initial CI
+            std::size_t idx{lc[k].size() - 1u};
+            while(idx > 0u && pmmath::fabs(lc[k][idx]) <= chop)
+                --idx;
+            lc[k].resize(idx + 1u);
+        }
+
+        // splitting only pays off if the degree of the pieces drops
+        // (it does not for CIs that oscillate over the whole domain)
+        if(4u * std::max(lc[0].size(), lc[1].size()) > 3u * (n + 1u)) {
+            colleagueeigs(r, c, kind, balance, lo, hi);
+            return;
+        }
+
+        std::vector<T> lr;
+        for(std::size_t k{0u}; k < 2u; ++k) {
+            std::size_t idx = lc[k].size() - 1u;
+            lr.clear();
+            if(idx > 1u) {
+                splitroots(lr, lc[k], FIRST, balance, depth + 1u);
+            } else if(idx == 1u) {
+                T root = -lc[k][0u] / lc[k][1u];
+                if(root > lo && root < hi)
+                    lr.push_back(root);
+            }
+            chgvar(lr, lr, bounds[k], bounds[k + 1u]);
+            r.insert(r.end(), lr.begin(), lr.end());
+        }
+    }
+
     template<typename T>
     void roots(std::vector<T>& r, std::vector<T>& c,
             std::pair<T, T> const& dom,
@@ -273,20 +678,23 @@ namespace pm {
 
         if(idx > 1u) {
             c.resize(idx + 1u);
-            MatrixXd<T> C = colleague(c, kind, balance);
-            Eigen::EigenSolver<MatrixXd<T>> es(C);
-            VectorXcd<T> eigs = es.eigenvalues();
-
-            T threshold = 1e-20;
-            for(Eigen::Index i{0}; i < eigs.size(); ++i) {
-                if(pmmath::fabs(eigs(i).imag()) < threshold)
-                    if(dom.first < eigs(i).real() && 
-                    dom.second > eigs(i).real()) {
-                        r.push_back(eigs(i).real());
-                    }
+            if(idx <= ROOTS_SPLIT_DEGREE) {
+                colleagueeigs(r, c, kind, balance, dom.first, dom.second);
+                std::sort(begin(r), end(r));
+            } else {
+                std::vector<T> sr;
+                splitroots(sr, c, kind, balance, 0u);
+                std::sort(begin(sr), end(sr));
+                // keep the roots inside dom, merging the copies of a root
+                // found on both sides of a split point
+                T tol = pmmath::sqrt(pmmath::epsilon<T>());
+                for(auto& it : sr) {
+                    if(!(dom.first < it && dom.second > it))
+                        continue;
+                    if(r.empty() || it - r.back() > tol)
+                        r.push_back(it);
+                }
             }
-
-            std::sort(begin(r), end(r));
         } else if(idx == 1) {
             r.push_back(-c[0u] / c[1u]);
         }
@@ -305,6 +713,11 @@ namespace pm {
 
     template void equipts<double>(std::vector<double>& v, std::size_t n);
 
+    template std::shared_ptr<const std::vector<double>> chebpts<double>(std::size_t n,
+            chebkind_t kind);
+
+    template void chebptsclear<double>();
+
 
     template void chebcoeffs<double>(std::vector<double>& c,
                     std::vector<double>& fv);
@@ -328,6 +741,11 @@ namespace pm {
 
     template void equipts<long double>(std::vector<long double>& v, std::size_t n);
 
+    template std::shared_ptr<const std::vector<long double>> chebpts<long double>(std::size_t n,
+            chebkind_t kind);
+
+    template void chebptsclear<long double>();
+
 
     template void chebcoeffs<long double>(std::vector<long double>& c,
                     std::vector<long double>& fv);
@@ -340,6 +758,94 @@ namespace pm {
             std::pair<long double, long double> const& dom,
             chebkind_t kind, bool balance);
 
+/* double-double precision */
+
+    template void cos<ddouble>(std::vector<ddouble>& out,
+            std::vector<ddouble> const& in);
+
+    template void chgvar<ddouble>(std::vector<ddouble>& out,
+            std::vector<ddouble> const& in,
+            ddouble& a, ddouble& b);
+
+    template void equipts<ddouble>(std::vector<ddouble>& v, std::size_t n);
+
+    template std::shared_ptr<const std::vector<ddouble>> chebpts<ddouble>(std::size_t n,
+            chebkind_t kind);
+
+    template void chebptsclear<ddouble>();
+
+
+    template void chebcoeffs<ddouble>(std::vector<ddouble>& c,
+                    std::vector<ddouble>& fv);
+
+    template void diffcoeffs<ddouble>(std::vector<ddouble>& dc,
+                    std::vector<ddouble>& c,
+                    chebkind_t kind);
+
+    template void roots<ddouble>(std::vector<ddouble>& r, std::vector<ddouble>& c,
+            std::pair<ddouble, ddouble> const& dom,
+            chebkind_t kind, bool balance);
+
+#ifdef HAVE_QUADMATH
+    /* quadruple precision */
+
+    template void cos<float128>(std::vector<float128>& out,
+            std::vector<float128> const& in);
+
+    template void chgvar<float128>(std::vector<float128>& out,
+            std::vector<float128> const& in,
+            float128& a, float128& b);
+
+    template void equipts<float128>(std::vector<float128>& v, std::size_t n);
+
+    template std::shared_ptr<const std::vector<float128>> chebpts<float128>(std::size_t n,
+            chebkind_t kind);
+
+    template void chebptsclear<float128>();
+
+
+    template void chebcoeffs<float128>(std::vector<float128>& c,
+                    std::vector<float128>& fv);
+
+    template void diffcoeffs<float128>(std::vector<float128>& dc,
+                    std::vector<float128>& c,
+                    chebkind_t kind);
+
+    template void roots<float128>(std::vector<float128>& r, std::vector<float128>& c,
+            std::pair<float128, float128> const& dom,
+            chebkind_t kind, bool balance);
+#endif
+
+#ifdef HAVE_BOOST_MP
+    /* octuple precision */
+
+    template void cos<float256>(std::vector<float256>& out,
+            std::vector<float256> const& in);
+
+    template void chgvar<float256>(std::vector<float256>& out,
+            std::vector<float256> const& in,
+            float256& a, float256& b);
+
+    template void equipts<float256>(std::vector<float256>& v, std::size_t n);
+
+    template std::shared_ptr<const std::vector<float256>> chebpts<float256>(std::size_t n,
+            chebkind_t kind);
+
+    template void chebptsclear<float256>();
+
+
+    template void chebcoeffs<float256>(std::vector<float256>& c,
+                    std::vector<float256>& fv);
+
+    template void diffcoeffs<float256>(std::vector<float256>& dc,
+                    std::vector<float256>& c,
+                    chebkind_t kind);
+
+    template void roots<float256>(std::vector<float256>& r, std::vector<float256>& c,
+            std::pair<float256, float256> const& dom,
+            chebkind_t kind, bool balance);
+#endif
+
 #ifdef HAVE_MPFR
     template void cos<mpfr::mpreal>(std::vector<mpfr::mpreal>& out,
             std::vector<mpfr::mpreal> const& in);
@@ -350,6 +856,11 @@ namespace pm {
 
     template void equipts<mpfr::mpreal>(std::vector<mpfr::mpreal>& v, std::size_t n);
 
+    template std::shared_ptr<const std::vector<mpfr::mpreal>> chebpts<mpfr::mpreal>(std::size_t n,
+            chebkind_t kind);
+
+    template void chebptsclear<mpfr::mpreal>();
+
 
     template void chebcoeffs<mpfr::mpreal>(std::vector<mpfr::mpreal>& c,
                     std::vector<mpfr::mpreal>& fv);
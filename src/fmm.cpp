@@ -0,0 +1,478 @@
+//    firpm
+//    Copyright (C) 2015 - 2024  S. Filip
+
+#include "firpm/fmm.h"
+#include "firpm/barycentric.h"
+#include "firpm/pmmath.h"
+#include <omp.h>
+
+namespace pm {
+
+    // a node is approximated through its proxies at points that are further
+    // away from its center than FMM_SEPARATION times its half-width; the
+    // interpolation error of the Chebyshev proxies then decays like
+    // rho^(-p), with rho = s + sqrt(s^2 - 1) for s = FMM_SEPARATION
+    constexpr double FMM_SEPARATION = 3.0;
+    // bounds on the number of proxies per node
+    constexpr std::size_t FMM_PMIN = 4u;
+    constexpr std::size_t FMM_PMAX = 64u;
+    // largest depth of the tree (a balanced binary tree never gets close)
+    constexpr std::size_t FMM_MAXDEPTH = 128u;
+
+    // value of the Lagrange basis polynomials associated to the proxies of
+    // the tree at the point s of [-1, 1]
+    template<typename T>
+    void lagrange(T* L, T const& s, barytree_t<T> const& tree)
+    {
+        std::size_t p = tree.p;
+        T sum = 0;
+        for (std::size_t k{0u}; k < p; ++k)
+        {
+            T d = s - tree.u[k];
+            if (d == 0) {
+                for (std::size_t l{0u}; l < p; ++l)
+                    L[l] = 0;
+                L[k] = 1;
+                return;
+            }
+            L[k] = tree.lambda[k] / d;
+            sum += L[k];
+        }
+        for (std::size_t k{0u}; k < p; ++k)
+            L[k] /= sum;
+    }
+
+    // computes the proxy charges Q of all the nodes of the tree from the
+    // charges q of the interpolation nodes (upward pass); the nodes are
+    // treated from the leaves up, so that the charges of a node can be
+    // obtained by interpolating those of its children
+    template<typename T>
+    void fmmup(std::vector<T>& Q, std::vector<T> const& q,
+            barytree_t<T> const& tree)
+    {
+        std::size_t p = tree.p;
+        Q.assign(tree.nodes.size() * p, T(0));
+        T L[FMM_PMAX];
+        for (std::size_t i = tree.nodes.size(); i-- > 0u;)
+        {
+            fmmnode_t<T> const& nd = tree.nodes[i];
+            T* Qi = &Q[i * p];
+            if (nd.r == 0) {
+                // all the charges are at the center of the node
+                for (std::size_t j{nd.first}; j < nd.last; ++j)
+                    Qi[0] += q[j];
+                continue;
+            }
+            if (nd.child == 0u) {
+                for (std::size_t j{nd.first}; j < nd.last; ++j)
+                {
+                    lagrange(L, (tree.y[j] - nd.c) / nd.r, tree);
+                    for (std::size_t k{0u}; k < p; ++k)
+                        Qi[k] += q[j] * L[k];
+                }
+            } else {
+                for (std::size_t ch{nd.child}; ch < nd.child + 2u; ++ch)
+                {
+                    for (std::size_t l{0u}; l < p; ++l)
+                    {
+                        T const& Ql = Q[ch * p + l];
+                        if (Ql == 0)
+                            continue;
+                        lagrange(L, (tree.yp[ch * p + l] - nd.c) / nd.r, tree);
+                        for (std::size_t k{0u}; k < p; ++k)
+                            Qi[k] += Ql * L[k];
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    void fmminit(barytree_t<T>& tree, std::vector<T> const& x,
+            double tol)
+    {
+        // number of proxies needed for the requested accuracy
+        if (tol <= 0.0)
+            tol = (double)pmmath::epsilon<T>();
+        double rho = FMM_SEPARATION + std::sqrt(FMM_SEPARATION * FMM_SEPARATION - 1.0);
+        std::size_t p = (std::size_t)std::ceil(-std::log(tol) / std::log(rho)) + 1u;
+        p = std::min(std::max(p, FMM_PMIN), FMM_PMAX);
+        tree.mac = FMM_SEPARATION;
+        if (tree.p != p || tree.u.size() != p) {
+            tree.p = p;
+            tree.u = *chebpts<T>(p, FIRST);
+            tree.lambda.resize(p);
+            for (std::size_t k{0u}; k < p; ++k)
+            {
+                tree.lambda[k] = pmmath::const_pi<T>() * (2u * k + 1u);
+                tree.lambda[k] /= (2u * p);
+                tree.lambda[k] = pmmath::sin(tree.lambda[k]);
+                if (k % 2u != 0u)
+                    tree.lambda[k] = -tree.lambda[k];
+            }
+        }
+
+        // sort the reference (the one used by the exchange algorithm already
+        // is, in which case the permutation is the identity)
+        std::size_t n = x.size();
+        tree.idx.resize(n);
+        for (std::size_t i{0u}; i < n; ++i)
+            tree.idx[i] = i;
+        if (!std::is_sorted(x.begin(), x.end()))
+            std::stable_sort(tree.idx.begin(), tree.idx.end(),
+                    [&x](std::size_t lhs, std::size_t rhs) {
+                        return x[lhs] < x[rhs];
+                    });
+        tree.y.resize(n);
+        for (std::size_t i{0u}; i < n; ++i)
+            tree.y[i] = x[tree.idx[i]];
+
+        // split the nodes in halves until the leaves hold at most p of them
+        // (treating a leaf directly is then no more expensive than through
+        // its proxies); the tree is built breadth first
+        tree.nodes.clear();
+        fmmnode_t<T> root;
+        root.first = 0u;
+        root.last = n;
+        root.child = 0u;
+        tree.nodes.push_back(root);
+        for (std::size_t i{0u}; i < tree.nodes.size(); ++i)
+        {
+            fmmnode_t<T>& nd = tree.nodes[i];
+            T lo = tree.y[nd.first];
+            T hi = tree.y[nd.last - 1u];
+            nd.c = (lo + hi) / 2;
+            nd.r = (hi - lo) / 2;
+            if (nd.last - nd.first > p && nd.r > 0) {
+                std::size_t mid = nd.first + (nd.last - nd.first) / 2u;
+                fmmnode_t<T> left, right;
+                left.first = nd.first;
+                left.last = mid;
+                left.child = 0u;
+                right.first = mid;
+                right.last = nd.last;
+                right.child = 0u;
+                nd.child = tree.nodes.size();
+                // nd is invalidated by the insertions
+                tree.nodes.push_back(left);
+                tree.nodes.push_back(right);
+            }
+        }
+
+        tree.yp.resize(tree.nodes.size() * p);
+        for (std::size_t i{0u}; i < tree.nodes.size(); ++i)
+            for (std::size_t k{0u}; k < p; ++k)
+                tree.yp[i * p + k] = tree.nodes[i].c + tree.nodes[i].r * tree.u[k];
+    }
+
+    // evaluates sum_j q_j K(t, y_j) over the interpolation nodes of the tree,
+    // where near is called on each node j of the leaves close to t and far on
+    // each proxy k of the nodes that are well separated from t
+    template<typename T, typename NearFun, typename FarFun>
+    void fmmvisit(barytree_t<T> const& tree, T const& t,
+            NearFun near, FarFun far)
+    {
+        std::size_t stack[FMM_MAXDEPTH];
+        std::size_t top{0u};
+        stack[top++] = 0u;
+        while (top > 0u)
+        {
+            std::size_t i = stack[--top];
+            fmmnode_t<T> const& nd = tree.nodes[i];
+            if (nd.child == 0u) {
+                for (std::size_t j{nd.first}; j < nd.last; ++j)
+                    if (!near(j))
+                        return;
+            } else if (pmmath::fabs(t - nd.c) > tree.mac * nd.r) {
+                for (std::size_t k{i * tree.p}; k < (i + 1u) * tree.p; ++k)
+                    far(k);
+            } else {
+                stack[top++] = nd.child + 1u;
+                stack[top++] = nd.child;
+            }
+        }
+    }
+
+    template<typename T>
+    void fmmweights(std::vector<T>& w, barytree_t<T>& tree)
+    {
+        std::size_t n = tree.y.size();
+        tree.q.assign(n, T(1));
+        fmmup(tree.Q1, tree.q, tree);
+
+        // w_i = 1 / prod_{j != i} 2(y_i - y_j): the logarithm of the
+        // denominator is a sum over all the other nodes, its sign is given
+        // by the number of nodes to the right of y_i
+        tree.wy.resize(n);
+        w.resize(n);
+        T log2 = pmmath::log(T(2));
+        unsigned long prec = precscope_t<T>::current();
+        #pragma omp parallel if(!omp_in_parallel())
+        {
+            precscope_t<T> scope(prec);
+            #pragma omp for
+            for (std::size_t i = 0u; i < n; ++i)
+            {
+                T const& yi = tree.y[i];
+                T denom = 0;
+                fmmvisit(tree, yi,
+                    [&](std::size_t j) {
+                        if (j != i)
+                            denom += pmmath::log(pmmath::fabs(yi - tree.y[j]));
+                        return true;
+                    },
+                    [&](std::size_t k) {
+                        denom += tree.Q1[k] * pmmath::log(pmmath::fabs(yi - tree.yp[k]));
+                    });
+                T one = ((n - 1u - i) % 2u == 0u) ? 1 : -1;
+                tree.wy[i] = one / pmmath::exp(denom + log2 * (n - 1u));
+                w[tree.idx[i]] = tree.wy[i];
+            }
+        }
+    }
+
+    template<typename T>
+    void fmmcharges(barytree_t<T>& tree, std::vector<T> const& C)
+    {
+        std::size_t n = tree.y.size();
+        tree.f.resize(n);
+        tree.q.resize(n);
+        for (std::size_t i{0u}; i < n; ++i)
+        {
+            tree.f[i] = C[tree.idx[i]];
+            tree.q[i] = tree.wy[i] * tree.f[i];
+        }
+        fmmup(tree.Qf, tree.q, tree);
+        fmmup(tree.Qw, tree.wy, tree);
+    }
+
+    // value of the interpolant at t; if t is one of the interpolation nodes,
+    // its (sorted) index is returned in hit, otherwise hit is set to the
+    // number of nodes
+    template<typename T>
+    void fmmeval(T& Pc, std::size_t& hit, T const& t,
+            barytree_t<T> const& tree)
+    {
+        T num, denom, buff;
+        num = denom = 0;
+        hit = tree.y.size();
+        fmmvisit(tree, t,
+            [&](std::size_t j) {
+                if (t == tree.y[j]) {
+                    hit = j;
+                    return false;
+                }
+                buff = tree.wy[j] / (t - tree.y[j]);
+                num += buff * tree.f[j];
+                denom += buff;
+                return true;
+            },
+            [&](std::size_t k) {
+                buff = t - tree.yp[k];
+                num += tree.Qf[k] / buff;
+                denom += tree.Qw[k] / buff;
+            });
+        if (hit < tree.y.size())
+            Pc = tree.f[hit];
+        else
+            Pc = num / denom;
+    }
+
+    template<typename T>
+    void approx(std::vector<T>& Pc, std::vector<T> const& xVal,
+            barytree_t<T> const& tree)
+    {
+        Pc.resize(xVal.size());
+        std::size_t hit;
+        for (std::size_t i{0u}; i < xVal.size(); ++i)
+            fmmeval(Pc[i], hit, xVal[i], tree);
+    }
+
+    template<typename T>
+    void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+            T const& delta, barytree_t<T> const& tree,
+            std::vector<band_t<T>>& bands)
+    {
+        comperror(error, xVal, delta, tree, bands, bandsorted(bands));
+    }
+
+    template<typename T>
+    void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+            T const& delta, barytree_t<T> const& tree,
+            std::vector<band_t<T>>& bands, bool sorted)
+    {
+        static thread_local std::vector<T> D, W;
+        idealvals(D, W, xVal, bands, sorted);
+        error.resize(xVal.size());
+        std::size_t hit;
+        for (std::size_t i{0u}; i < xVal.size(); ++i)
+        {
+            fmmeval(error[i], hit, xVal[i], tree);
+            if (hit < tree.y.size()) {
+                error[i] = (tree.idx[hit] % 2u == 0u) ? delta : -delta;
+            } else {
+                error[i] -= D[i];
+                error[i] *= W[i];
+            }
+        }
+    }
+
+    /* Template instantiations */
+
+    /* double precision */
+
+    template void fmminit<double>(barytree_t<double>& tree,
+            std::vector<double> const& x, double tol);
+
+    template void fmmweights<double>(std::vector<double>& w,
+            barytree_t<double>& tree);
+
+    template void fmmcharges<double>(barytree_t<double>& tree,
+            std::vector<double> const& C);
+
+    template void approx<double>(std::vector<double>& Pc,
+            std::vector<double> const& xVal,
+            barytree_t<double> const& tree);
+
+    template void comperror<double>(std::vector<double>& error,
+            std::vector<double> const& xVal, double const& delta,
+            barytree_t<double> const& tree,
+            std::vector<band_t<double>>& bands);
+
+    template void comperror<double>(std::vector<double>& error,
+            std::vector<double> const& xVal, double const& delta,
+            barytree_t<double> const& tree,
+            std::vector<band_t<double>>& bands, bool sorted);
+
+    /* long double precision */
+
+    template void fmminit<long double>(barytree_t<long double>& tree,
+            std::vector<long double> const& x, double tol);
+
+    template void fmmweights<long double>(std::vector<long double>& w,
+            barytree_t<long double>& tree);
+
+    template void fmmcharges<long double>(barytree_t<long double>& tree,
+            std::vector<long double> const& C);
+
+    template void approx<long double>(std::vector<long double>& Pc,
+            std::vector<long double> const& xVal,
+            barytree_t<long double> const& tree);
+
+    template void comperror<long double>(std::vector<long double>& error,
+            std::vector<long double> const& xVal, long double const& delta,
+            barytree_t<long double> const& tree,
+            std::vector<band_t<long double>>& bands);
+
+    template void comperror<long double>(std::vector<long double>& error,
+            std::vector<long double> const& xVal, long double const& delta,
+            barytree_t<long double> const& tree,
+            std::vector<band_t<long double>>& bands, bool sorted);
+
+/* double-double precision */
+
+    template void fmminit<ddouble>(barytree_t<ddouble>& tree,
+            std::vector<ddouble> const& x, double tol);
+
+    template void fmmweights<ddouble>(std::vector<ddouble>& w,
+            barytree_t<ddouble>& tree);
+
+    template void fmmcharges<ddouble>(barytree_t<ddouble>& tree,
+            std::vector<ddouble> const& C);
+
+    template void approx<ddouble>(std::vector<ddouble>& Pc,
+            std::vector<ddouble> const& xVal,
+            barytree_t<ddouble> const& tree);
+
+    template void comperror<ddouble>(std::vector<ddouble>& error,
+            std::vector<ddouble> const& xVal, ddouble const& delta,
+            barytree_t<ddouble> const& tree,
+            std::vector<band_t<ddouble>>& bands);
+
+    template void comperror<ddouble>(std::vector<ddouble>& error,
+            std::vector<ddouble> const& xVal, ddouble const& delta,
+            barytree_t<ddouble> const& tree,
+            std::vector<band_t<ddouble>>& bands, bool sorted);
+
+#ifdef HAVE_QUADMATH
+    /* quadruple precision */
+
+    template void fmminit<float128>(barytree_t<float128>& tree,
+            std::vector<float128> const& x, double tol);
+
+    template void fmmweights<float128>(std::vector<float128>& w,
+            barytree_t<float128>& tree);
+
+    template void fmmcharges<float128>(barytree_t<float128>& tree,
+            std::vector<float128> const& C);
+
+    template void approx<float128>(std::vector<float128>& Pc,
+            std::vector<float128> const& xVal,
+            barytree_t<float128> const& tree);
+
+    template void comperror<float128>(std::vector<float128>& error,
+            std::vector<float128> const& xVal, float128 const& delta,
+            barytree_t<float128> const& tree,
+            std::vector<band_t<float128>>& bands);
+
+    template void comperror<float128>(std::vector<float128>& error,
+            std::vector<float128> const& xVal, float128 const& delta,
+            barytree_t<float128> const& tree,
+            std::vector<band_t<float128>>& bands, bool sorted);
+#endif
+
+#ifdef HAVE_BOOST_MP
+    /* octuple precision */
+
+    template void fmminit<float256>(barytree_t<float256>& tree,
+            std::vector<float256> const& x, double tol);
+
+    template void fmmweights<float256>(std::vector<float256>& w,
+            barytree_t<float256>& tree);
+
+    template void fmmcharges<float256>(barytree_t<float256>& tree,
+            std::vector<float256> const& C);
+
+    template void approx<float256>(std::vector<float256>& Pc,
+            std::vector<float256> const& xVal,
+            barytree_t<float256> const& tree);
+
+    template void comperror<float256>(std::vector<float256>& error,
+            std::vector<float256> const& xVal, float256 const& delta,
+            barytree_t<float256> const& tree,
+            std::vector<band_t<float256>>& bands);
+
+    template void comperror<float256>(std::vector<float256>& error,
+            std::vector<float256> const& xVal, float256 const& delta,
+            barytree_t<float256> const& tree,
+            std::vector<band_t<float256>>& bands, bool sorted);
+#endif
+
+#ifdef HAVE_MPFR
+    /* MPFR precision */
+
+    template void fmminit<mpfr::mpreal>(barytree_t<mpfr::mpreal>& tree,
+            std::vector<mpfr::mpreal> const& x, double tol);
+
+    template void fmmweights<mpfr::mpreal>(std::vector<mpfr::mpreal>& w,
+            barytree_t<mpfr::mpreal>& tree);
+
+    template void fmmcharges<mpfr::mpreal>(barytree_t<mpfr::mpreal>& tree,
+            std::vector<mpfr::mpreal> const& C);
+
+    template void approx<mpfr::mpreal>(std::vector<mpfr::mpreal>& Pc,
+            std::vector<mpfr::mpreal> const& xVal,
+            barytree_t<mpfr::mpreal> const& tree);
+
+    template void comperror<mpfr::mpreal>(std::vector<mpfr::mpreal>& error,
+            std::vector<mpfr::mpreal> const& xVal, mpfr::mpreal const& delta,
+            barytree_t<mpfr::mpreal> const& tree,
+            std::vector<band_t<mpfr::mpreal>>& bands);
+
+    template void comperror<mpfr::mpreal>(std::vector<mpfr::mpreal>& error,
+            std::vector<mpfr::mpreal> const& xVal, mpfr::mpreal const& delta,
+            barytree_t<mpfr::mpreal> const& tree,
+            std::vector<band_t<mpfr::mpreal>>& bands, bool sorted);
+#endif
+
+} // namespace pm
@@ -4,12 +4,17 @@
 #include "firpm/pm.h"
 #include "firpm/band.h"
 #include "firpm/barycentric.h"
+#include "firpm/fmm.h"
 #include "firpm/pmmath.h"
-#include <set>
+#include <omp.h>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <chrono>
+#include <atomic>
+#include <map>
+#include <mutex>
 
 namespace pm {
 
@@ -19,8 +24,148 @@ namespace pm {
     template<typename T>
     using VectorXd = Eigen::Matrix<T, Eigen::Dynamic, 1>;
 
-    // global variable used to detect cycling
-    bool cycle;
+    // starting and largest degrees of the interpolants used on each
+    // subinterval when nmax is NMAX_ADAPTIVE
+    constexpr std::size_t ADAPTIVE_NMIN = 4u;
+    constexpr std::size_t ADAPTIVE_NMAX = 128u;
+
+    // smallest reference set for which bary_t::AUTO switches to the
+    // hierarchical evaluation of the barycentric formulas
+    constexpr std::size_t FMM_AUTO_SIZE = 2048u;
+
+    // number of iterations without a decrease of the convergence parameter
+    // after which a lower precision run of the precision ladder is stopped
+    constexpr std::size_t LADDER_PATIENCE = 3u;
+
+    // the next lower rung of the precision ladder (the type itself if there
+    // is none)
+    template<typename T>
+    struct lowerprec { using type = T; };
+
+    template<>
+    struct lowerprec<long double> { using type = double; };
+
+    template<>
+    struct lowerprec<ddouble> { using type = long double; };
+
+#ifdef HAVE_QUADMATH
+    template<>
+    struct lowerprec<float128> { using type = ddouble; };
+#endif
+
+#ifdef HAVE_BOOST_MP
+    template<>
+    struct lowerprec<float256> { using type = ddouble; };
+#endif
+
+#ifdef HAVE_MPFR
+    template<>
+    struct lowerprec<mpfr::mpreal> { using type = long double; };
+#endif
+
+    // types for which bary_t::AUTO may select the hierarchical evaluation
+    // (for the MPFR and octuple precision types the proxies would need a much
+    // larger degree)
+    template<typename T>
+    bool fmmauto() { return false; }
+
+    template<>
+    bool fmmauto<double>() { return true; }
+
+    template<>
+    bool fmmauto<long double>() { return true; }
+
+    template<>
+    bool fmmauto<ddouble>() { return true; }
+
+#ifdef HAVE_QUADMATH
+    template<>
+    bool fmmauto<float128>() { return true; }
+#endif
+
+    /* Scratch memory used by one thread while it searches for the
+     * extrema located inside a subinterval. */
+    template<typename T>
+    struct subws_t {
+        std::vector<T> siCN;    // Chebyshev nodes scaled to the subinterval
+        std::vector<T> fx;      // error values at the scaled nodes
+        std::vector<T> c;       // Chebyshev coefficients of the error
+        std::vector<T> dc;      // coefficients of its derivative
+        std::vector<T> r;       // roots of the derivative
+        std::vector<T> pts;     // block of candidate extrema
+        std::vector<T> err;     // error values at these candidates
+        std::vector<T> cand;    // candidate extrema found by this thread
+    };
+
+    /* Memory reused by all the iterations of the exchange algorithm. It is
+     * sized once per design (see wsinit) from the reference size and nmax,
+     * so that the steady-state iterations do not need to allocate. */
+    template<typename T>
+    struct exchws_t {
+        std::vector<T> splitpts;
+        std::vector<std::pair<T, T>> subIntervals;
+        std::vector<T> w;                   // barycentric weights
+        std::vector<T> C;                   // filter response at the reference
+        std::vector<T> D;                   // ideal response at the reference
+        std::vector<T> W;                   // weight at the reference
+        std::shared_ptr<const std::vector<T>> chebyNodes;
+                                            // Chebyshev nodes of size nmax + 1
+        std::vector<T> pEx;                 // candidate extrema of all the subintervals
+        std::vector<std::pair<T, T>> potentialExtrema;
+        std::vector<std::pair<T, T>> alternatingExtrema;
+        std::vector<subws_t<T>> sub;        // per-thread scratch
+        barytree_t<T> tree;                 // tree of the reference (FMM mode)
+    };
+
+    /* Control of one call to exchange(), shared by all the runs of the
+     * precision ladder. */
+    struct runctl_t {
+        std::chrono::steady_clock::time_point start;
+        bool stopped;           // the observer asked to stop the iterations
+        std::atomic<bool> const* cancel;
+        std::chrono::steady_clock::time_point deadline;
+        bool armed;             // there is a cancellation flag or a deadline
+        bool interrupted;       // the iterations were cut short by them
+
+        // both conditions persist once they hold, so that the worker
+        // threads and the calling thread agree on them
+        bool expired() const {
+            return armed && ((cancel && cancel->load(std::memory_order_relaxed)) ||
+                    std::chrono::steady_clock::now() >= deadline);
+        }
+    };
+
+    // thrown by extrema() when the design is interrupted in the middle of
+    // an iteration
+    struct interrupt_t {};
+
+    // thrown by extrema() when it finds fewer alternating extrema than
+    // reference points, which in adaptive mode is retried with denser
+    // interpolants (other failures are not)
+    struct missingextrema_t : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    /* Per-design state of the exchange algorithm. Each call to exchange()
+     * owns one of these, so that independent designs can run concurrently
+     * on different threads without sharing any mutable state. */
+    template<typename T>
+    struct exchctx_t {
+        bool cycle;             // cycling detected, change the removal rule
+        T qp1;                  // convergence parameter at iteration k-1
+        T qp2;                  // convergence parameter at iteration k-2
+        double eps;             // convergence threshold
+        std::size_t nmax;       // degree used by the CPR method on each subinterval
+                                // (upper bound on it in adaptive mode)
+        bool adaptive;          // choose the degree on each subinterval
+        std::size_t nmin;       // starting degree in adaptive mode
+        unsigned long prec;     // MPFR precision (ignored for the other types)
+        bool sorted;            // the bands are ordered (see bandsorted)
+        bool fmm;               // evaluate the barycentric formulas through ws.tree
+        double fmmtol;          // accuracy of the hierarchical evaluation
+        runctl_t const* ctl;    // cancellation and deadline of the design
+        exchws_t<T> ws;         // iteration workspace
+    };
 
     template<typename T>
     void chebvand(MatrixXd<T>& A, std::size_t degree,
@@ -75,13 +220,150 @@ namespace pm {
         }
     }
 
+    namespace {
+
+    // index of the band [edges[2i], edges[2i+1]] nearest to x (the first
+    // one that holds it, if any); dist is set to the distance from x to
+    // that band, which is not positive if x lies inside it (there must be
+    // at least one band)
+    template<typename T>
+    std::size_t nearestband(T& dist, T const& x, std::vector<T> const& edges)
+    {
+        std::size_t bi{0u};
+        dist = pmmath::fmax(edges[0] - x, x - edges[1]);
+        for(std::size_t i{2u}; i + 1u < edges.size(); i += 2u) {
+            T d = pmmath::fmax(edges[i] - x, x - edges[i + 1u]);
+            if(d < dist) {
+                dist = d;
+                bi = i / 2u;
+            }
+        }
+        return bi;
+    }
+
+    } // anonymous namespace
+
+    // moves the points of x that are outside of the bands cb onto the
+    // nearest band edge
+    template<typename T>
+    void snapbands(std::vector<T>& x, std::vector<band_t<T>> const& cb)
+    {
+        std::vector<T> edges;
+        edges.reserve(2u * cb.size());
+        for(auto const& it : cb) {
+            edges.push_back(it.start);
+            edges.push_back(it.stop);
+        }
+        for(auto& it : x) {
+            T dist = 0;
+            std::size_t bi = nearestband(dist, it, edges);
+            if(dist > 0)
+                it = (it < cb[bi].start) ? cb[bi].start : cb[bi].stop;
+        }
+    }
+
+    // turns the starting reference x0 given by the user (in the space
+    // given by space) into a reference of nx points for the bands cb: the
+    // points are sorted and moved into their nearest band; if their number
+    // then differs from nx, each band gets a share of the nx points in
+    // proportion to the number of points of x0 that it holds (at least one
+    // if it holds none), placed by linear interpolation between them
+    template<typename T>
+    void warmstart(status_t& status, std::vector<T>& x,
+            std::vector<T> const& x0, space_t space,
+            std::vector<band_t<T>>& cb, std::size_t nx)
+    {
+        // the interval is widened a little, so that points computed from
+        // a differently rounded pi are still accepted
+        T lo = (space == space_t::FREQ) ? T(0) : T(-1);
+        T hi = (space == space_t::FREQ) ? pmmath::const_pi<T>() : T(1);
+        lo -= 1e-10;
+        hi += 1e-10;
+        x.clear();
+        for(auto const& it : x0) {
+            if(!pmmath::isfinite(it) || it < lo || it > hi) {
+                status = status_t::STATUS_FREQUENCY_INVALID_INTERVAL;
+                throw std::domain_error("ERROR: Starting reference outside of the "
+                        "frequency interval");
+            }
+            x.push_back((space == space_t::FREQ) ? pmmath::cos(it) : it);
+        }
+        std::sort(x.begin(), x.end());
+        snapbands(x, cb);
+        x.erase(std::unique(x.begin(), x.end()), x.end());
+        countBand(cb, x);
+        if(x.size() == nx)
+            return;
+
+        // apportion the nx points between the bands (largest remainders),
+        // the bands reduced to a single frequency get one
+        std::vector<std::size_t> m(cb.size(), 0u);
+        std::vector<double> frac(cb.size(), -1.0);
+        std::size_t left{nx};
+        double total{0.0};
+        for(std::size_t i{0u}; i < cb.size(); ++i) {
+            if(cb[i].start == cb[i].stop) {
+                if(left == 0u) {
+                    status = status_t::STATUS_FREQUENCY_INVALID_INTERVAL;
+                    throw std::domain_error("ERROR: Starting reference too "
+                            "small for the number of bands");
+                }
+                m[i] = 1u;
+                --left;
+            } else {
+                total += std::max<std::size_t>(cb[i].xs, 1u);
+            }
+        }
+        std::size_t given{0u};
+        for(std::size_t i{0u}; i < cb.size(); ++i) {
+            if(cb[i].start == cb[i].stop)
+                continue;
+            double share = left * std::max<std::size_t>(cb[i].xs, 1u) / total;
+            m[i] = (std::size_t)share;
+            frac[i] = share - m[i];
+            given += m[i];
+        }
+        for(; given < left; ++given) {
+            std::size_t bi = std::max_element(frac.begin(), frac.end()) - frac.begin();
+            ++m[bi];
+            frac[bi] = -1.0;
+        }
+
+        std::vector<T> nx0;
+        std::size_t offset{0u};
+        for(std::size_t i{0u}; i < cb.size(); ++i) {
+            std::size_t k = cb[i].xs;
+            if(m[i] == 1u) {
+                nx0.push_back(k > 0u ? x[offset + (k - 1u) / 2u]
+                                     : (cb[i].start + cb[i].stop) / 2);
+            } else if(k < 2u) {
+                for(std::size_t j{0u}; j < m[i]; ++j)
+                    nx0.push_back(cb[i].start +
+                            (cb[i].stop - cb[i].start) * j / (m[i] - 1u));
+            } else {
+                // point j sits at position j(k-1)/(m-1) in the k points
+                for(std::size_t j{0u}; j < m[i]; ++j) {
+                    std::size_t l = j * (k - 1u) / (m[i] - 1u);
+                    T t = T(j * (k - 1u) - l * (m[i] - 1u)) / (m[i] - 1u);
+                    if(l == k - 1u) {
+                        --l;
+                        t = 1;
+                    }
+                    nx0.push_back(x[offset + l] + (x[offset + l + 1u] - x[offset + l]) * t);
+                }
+            }
+            offset += k;
+        }
+        x = nx0;
+        countBand(cb, x);
+    }
+
     template<typename T>
     void wam(std::vector<T>& wam, std::vector<band_t<T>>& cb,
             std::size_t deg)
     {
-        std::vector<T> cp;
-        equipts(cp, deg + 2u);
-        cos(cp, cp);
+        std::shared_ptr<const std::vector<T>> nodes = chebpts<T>(deg + 2u);
+        std::vector<T> cp(nodes->rbegin(), nodes->rend());
         std::sort(begin(cp), end(cp));
         for(std::size_t i{0u}; i < cb.size(); ++i)
         {
@@ -266,74 +548,227 @@ namespace pm {
     }
 
     template<typename T>
-    void split(std::vector<std::pair<T, T>>& subIntervals,
+    void wsinit(exchws_t<T>& ws, std::vector<band_t<T>>& chebyBands,
+            std::size_t xSize, std::size_t Nmax)
+    {
+        // upper bound on the number of points splitting [-1, 1]
+        std::size_t nsplit = xSize;
+        for(auto& it : chebyBands)
+            nsplit += it.part.size() + 2u;
+
+        ws.splitpts.resize(nsplit);
+        ws.subIntervals.resize(nsplit);
+        ws.w.resize(xSize);
+        ws.C.resize(xSize);
+        ws.D.resize(xSize);
+        ws.W.resize(xSize);
+        ws.chebyNodes = chebpts<T>(Nmax + 1u);
+
+        ws.pEx.reserve(nsplit * (Nmax + 1u));
+        ws.potentialExtrema.resize(2u * chebyBands.size() + ws.pEx.capacity());
+        ws.alternatingExtrema.reserve(ws.potentialExtrema.size());
+
+        // one scratch space per thread of the parallel regions of the
+        // iterations; when the design itself runs on a thread of a parallel
+        // region (e.g. in firpm_batch), these regions are not started, even
+        // if nested parallelism is enabled, so that concurrent designs do
+        // not oversubscribe the cores
+        std::size_t nthreads = omp_in_parallel() ? 1u : omp_get_max_threads();
+        ws.sub.resize(nthreads);
+        for(auto& it : ws.sub) {
+            it.siCN.resize(Nmax + 1u);
+            it.fx.resize(Nmax + 1u);
+            it.c.resize(Nmax + 1u);
+            it.dc.resize(Nmax);
+            it.r.reserve(Nmax);
+            it.pts.reserve(64u);
+            it.err.reserve(64u);
+        }
+    }
+
+    // splits [-1, 1] at the reference points and at the band (and partition)
+    // edges; returns the number of subintervals stored in subIntervals
+    template<typename T>
+    std::size_t split(std::vector<std::pair<T, T>>& subIntervals,
+            std::vector<T>& splitpts,
             std::vector<band_t<T>>& chebyBands,
             std::vector<T> &x) {
-        std::vector<T> splitpts = x;
+        std::size_t npts{0u};
+        for(auto& it : x)
+            splitpts[npts++] = it;
         for(std::size_t i{0u}; i < chebyBands.size(); ++i) {
-            splitpts.push_back(chebyBands[i].start);
-            splitpts.insert(splitpts.end(), chebyBands[i].part.begin(), chebyBands[i].part.end());
-            splitpts.push_back(chebyBands[i].stop);
+            splitpts[npts++] = chebyBands[i].start;
+            for(auto& it : chebyBands[i].part)
+                splitpts[npts++] = it;
+            splitpts[npts++] = chebyBands[i].stop;
         }
 
-        std::set<T> s(splitpts.begin(), splitpts.end());
-        splitpts.assign(s.begin(), s.end());
-        std::sort(splitpts.begin(), splitpts.end());
+        std::sort(splitpts.begin(), splitpts.begin() + npts);
+        npts = std::unique(splitpts.begin(), splitpts.begin() + npts)
+            - splitpts.begin();
 
         std::size_t bidx{0u};
-        for(std::size_t i{0u}; i < splitpts.size()-1u; ++i) {
+        std::size_t nsi{0u};
+        for(std::size_t i{0u}; i < npts-1u; ++i) {
             if(splitpts[i+1u] > chebyBands[bidx].stop) {
                 ++bidx;
             } else {
-                subIntervals.push_back(std::make_pair(splitpts[i], splitpts[i+1u]));
+                subIntervals[nsi].first = splitpts[i];
+                subIntervals[nsi].second = splitpts[i+1u];
+                ++nsi;
             }
         }
+        return nsi;
+    }
+
+    // error at the nodes of xVal, evaluated directly or through the tree
+    // built for the current reference (see fmm.h)
+    template<typename T>
+    void comperror(std::vector<T>& error, std::vector<T> const& xVal,
+            T& delta, std::vector<T>& x, exchctx_t<T>& ctx,
+            std::vector<band_t<T>>& chebyBands)
+    {
+        if(ctx.fmm)
+            comperror(error, xVal, delta, ctx.ws.tree, chebyBands, ctx.sorted);
+        else
+            comperror(error, xVal, delta, x, ctx.ws.C, ctx.ws.w, chebyBands,
+                    ctx.sorted);
+    }
+
+    // computes in sws.c the coefficients of the CI of the error on the
+    // subinterval si, starting with degree nmin and doubling it (the Chebyshev
+    // nodes of the second kind are nested, so that the error values already
+    // computed are reused) until the tail of the coefficients is below tol
+    // (relative to the largest coefficient) or the degree would exceed nmax;
+    // the negligible trailing coefficients are then dropped
+    template<typename T>
+    void adaptiveci(subws_t<T>& sws, std::pair<T, T>& si,
+            T& delta, std::vector<T>& x, exchctx_t<T>& ctx,
+            std::vector<band_t<T>>& chebyBands,
+            T const& tol, std::size_t nmin, std::size_t nmax)
+    {
+        std::size_t N = nmin;
+
+        // the error vanishes outside of the bands, so that it is not smooth
+        // on the subintervals covering the gaps between them; they are not
+        // refined
+        bool gap{true};
+        T mid = (si.first + si.second) / 2;
+        for(auto& it : chebyBands)
+            if(mid >= it.start && mid <= it.stop)
+                gap = false;
+
+        std::shared_ptr<const std::vector<T>> nodes = chebpts<T>(N + 1u);
+        chgvar(sws.siCN, *nodes, si.first, si.second);
+        // use the exact endpoints, the rounded ones can fall just outside
+        // of a band (where the error is zero), which is not a smooth
+        // function to interpolate
+        sws.siCN.front() = si.second;
+        sws.siCN.back() = si.first;
+        comperror(sws.fx, sws.siCN, delta, x, ctx, chebyBands);
+
+        T cmax;
+        for(;;) {
+            sws.c.resize(N + 1u);
+            chebcoeffs(sws.c, sws.fx);
+            cmax = 0;
+            for(auto& it : sws.c)
+                cmax = pmmath::fmax(cmax, pmmath::fabs(it));
+            T tail = pmmath::fabs(sws.c[N - 1u]) + pmmath::fabs(sws.c[N]);
+            if(gap || tail <= tol * cmax || 2u * N > nmax)
+                break;
+
+            // the error is only evaluated at the new nodes (those of odd
+            // index in the set of 2N + 1 nodes)
+            nodes = chebpts<T>(2u * N + 1u);
+            sws.pts.resize(N);
+            for(std::size_t j{0u}; j < N; ++j)
+                sws.pts[j] = (*nodes)[2u * j + 1u];
+            chgvar(sws.pts, sws.pts, si.first, si.second);
+            comperror(sws.err, sws.pts, delta, x, ctx, chebyBands);
+            sws.fx.resize(2u * N + 1u);
+            for(std::size_t j{N}; j > 0u; --j)
+                sws.fx[2u * j] = sws.fx[j];
+            for(std::size_t j{0u}; j < N; ++j)
+                sws.fx[2u * j + 1u] = sws.err[j];
+            N *= 2u;
+        }
+
+        std::size_t idx{N};
+        while(idx > 2u && pmmath::fabs(sws.c[idx]) <= tol * cmax)
+            --idx;
+        sws.c.resize(idx + 1u);
+    }
+
+    // reference error of a candidate reference set; in FMM mode the
+    // barycentric weights come from a tree built for the set instead of
+    // the O(n^2) products of compdelta
+    template<typename T>
+    void refdelta(T& delta, std::vector<T>& x,
+            std::vector<band_t<T>>& chebyBands, exchctx_t<T> const& ctx)
+    {
+        if(!ctx.fmm) {
+            compdelta(delta, x, chebyBands);
+            return;
+        }
+        barytree_t<T> tree;
+        std::vector<T> w(x.size()), D, W;
+        fmminit(tree, x, ctx.fmmtol);
+        fmmweights(w, tree);
+        idealvals(D, W, x, chebyBands, ctx.sorted);
+        compdelta(delta, w, D, W);
     }
 
     template<typename T>
     void extrema(status_t& status, T& convergenceOrder,
             T& delta, std::vector<T>& eigenExtrema,
             std::vector<T>& x, std::vector<band_t<T>>& chebyBands,
-            std::size_t Nmax, unsigned long prec)
+            exchctx_t<T>& ctx)
     {
-    #ifdef HAVE_MPFR
-        mpfr_prec_t prevPrec = mpfr::mpreal::get_default_prec();
-        mpfr::mpreal::set_default_prec(prec);
-    #endif
+        std::size_t Nmax = ctx.nmax;
+        exchws_t<T>& ws = ctx.ws;
 
         // 1.   Split the initial [-1, 1] interval in subintervals
         //      in order that we can use a reasonable size matrix
         //      eigenvalue solver on the subintervals
-        std::vector<std::pair<T, T>> subIntervals;
+        std::vector<std::pair<T, T>>& subIntervals = ws.subIntervals;
         std::pair<T, T> dom{std::make_pair(-1.0, 1.0)};
 
-        split(subIntervals, chebyBands, x);
+        std::size_t nsi = split(subIntervals, ws.splitpts, chebyBands, x);
 
         // 2.   Compute the barycentric variables (i.e., weights)
         //      needed for the current iteration
-        std::vector<T> w(x.size());
-        baryweights(w, x);
+        std::vector<T>& w = ws.w;
+        if(ctx.fmm) {
+            fmminit(ws.tree, x, ctx.fmmtol);
+            fmmweights(w, ws.tree);
+        } else {
+            baryweights(w, x);
+        }
 
-        compdelta(delta, w, x, chebyBands);
+        // the ideal response and weight at the reference are looked up
+        // once and shared by the computation of delta and C
+        idealvals(ws.D, ws.W, x, chebyBands, ctx.sorted);
+        compdelta(delta, w, ws.D, ws.W);
 
-        std::vector<T> C(x.size());
-        compc(C, delta, x, chebyBands);
+        std::vector<T>& C = ws.C;
+        compc(C, delta, ws.D, ws.W);
+        if(ctx.fmm)
+            fmmcharges(ws.tree, C);
 
         // 3.   Use an eigenvalue solver on each subinterval to find the
         //      local extrema that are located inside the frequency bands
-        std::vector<T> chebyNodes(Nmax + 1u);
-        equipts(chebyNodes, Nmax + 1u);
-        cos(chebyNodes, chebyNodes);
+        std::vector<T> const& chebyNodes = *ws.chebyNodes;
 
-        std::vector<std::pair<T, T>> potentialExtrema;
-        std::vector<T> pEx;
+        std::vector<std::pair<T, T>>& potentialExtrema = ws.potentialExtrema;
+        std::size_t pCount{0u};
         T extremaErrorValueLeft;
         T extremaErrorValueRight;
         T extremaErrorValue;
         comperror(extremaErrorValue, chebyBands[0].start,
                 delta, x, C, w, chebyBands);
-        potentialExtrema.push_back(std::make_pair(
-                chebyBands[0].start, extremaErrorValue));
+        potentialExtrema[pCount].first = chebyBands[0].start;
+        potentialExtrema[pCount++].second = extremaErrorValue;
 
         for (std::size_t i{0u}; i < chebyBands.size() - 1u; ++i)
         {
@@ -344,127 +779,145 @@ namespace pm {
             bool sgnLeft = pmmath::signbit(extremaErrorValueLeft);
             bool sgnRight = pmmath::signbit(extremaErrorValueRight);
             if (sgnLeft != sgnRight) {
-                potentialExtrema.push_back(std::make_pair(
-                        chebyBands[i].stop, extremaErrorValueLeft));
-                potentialExtrema.push_back(std::make_pair(
-                        chebyBands[i + 1u].start, extremaErrorValueRight));
+                potentialExtrema[pCount].first = chebyBands[i].stop;
+                potentialExtrema[pCount++].second = extremaErrorValueLeft;
+                potentialExtrema[pCount].first = chebyBands[i + 1u].start;
+                potentialExtrema[pCount++].second = extremaErrorValueRight;
             } else {
                 T abs1 = pmmath::fabs(extremaErrorValueLeft);
                 T abs2 = pmmath::fabs(extremaErrorValueRight);
-                if(abs1 > abs2)
-                    potentialExtrema.push_back(std::make_pair(
-                            chebyBands[i].stop, extremaErrorValueLeft));
-                else
-                    potentialExtrema.push_back(std::make_pair(
-                            chebyBands[i + 1u].start, extremaErrorValueRight));
+                if(abs1 > abs2) {
+                    potentialExtrema[pCount].first = chebyBands[i].stop;
+                    potentialExtrema[pCount++].second = extremaErrorValueLeft;
+                } else {
+                    potentialExtrema[pCount].first = chebyBands[i + 1u].start;
+                    potentialExtrema[pCount++].second = extremaErrorValueRight;
+                }
             }
         }
         comperror(extremaErrorValue,
                 chebyBands[chebyBands.size() - 1u].stop,
                 delta, x, C, w, chebyBands);
-        potentialExtrema.push_back(std::make_pair(
-                chebyBands[chebyBands.size() - 1u].stop,
-                extremaErrorValue));
-
-        std::vector<std::vector<T>> pExs(subIntervals.size());
-        #pragma omp parallel for
-        for (std::size_t i = 0u; i < subIntervals.size(); ++i)
+        potentialExtrema[pCount].first = chebyBands[chebyBands.size() - 1u].stop;
+        potentialExtrema[pCount++].second = extremaErrorValue;
+
+        // the candidate extrema of each subinterval (the roots of the
+        // derivative of the CI and the two endpoints) are collected by
+        // the thread that processes it
+        std::vector<T>& pEx = ws.pEx;
+        for(auto& it : ws.sub)
+            it.cand.clear();
+        // the interpolants of the adaptive mode only need to be accurate
+        // enough for the extrema to pass the convergence test
+        T tol = ctx.eps;
+        tol /= 10;
+        #pragma omp parallel if(!omp_in_parallel())
         {
-            #ifdef HAVE_MPFR
-                mpfr_prec_t prevPrec = mpfr::mpreal::get_default_prec();
-                mpfr::mpreal::set_default_prec(prec);
-            #endif
-            // find the Chebyshev nodes scaled to the current subinterval
-            std::vector<T> siCN(Nmax + 1u);
-            chgvar(siCN, chebyNodes, subIntervals[i].first,
-                    subIntervals[i].second);
-
-            // compute the Chebyshev interpolation function values on the
-            // current subinterval
-            std::vector<T> fx(Nmax + 1u);
-            for (std::size_t j{0u}; j < fx.size(); ++j)
-                comperror(fx[j], siCN[j], delta, x, C, w,
-                        chebyBands);
-
-            // compute the values of the CI coefficients and those of its
-            // derivative
-            std::vector<T> c(Nmax + 1u);
-            chebcoeffs(c, fx);
-            std::vector<T> dc(Nmax);
-            diffcoeffs(dc, c);
-
-            // solve the corresponding eigenvalue problem and determine the
-            // local extrema situated in the current subinterval
-            std::vector<T> eigenRoots;
-            roots(eigenRoots, dc, dom);
-            if(!eigenRoots.empty()) {
-                chgvar(eigenRoots, eigenRoots,
-                        subIntervals[i].first, subIntervals[i].second);
-                for (std::size_t j{0u}; j < eigenRoots.size(); ++j)
-                    pExs[i].push_back(eigenRoots[j]);
-            }
-            pExs[i].push_back(subIntervals[i].first);
-            pExs[i].push_back(subIntervals[i].second);
-            #ifdef HAVE_MPFR
-                mpfr::mpreal::set_default_prec(prevPrec);
-            #endif
-        }
+            precscope_t<T> scope(ctx.prec);
+            subws_t<T>& sws = ws.sub[omp_get_thread_num()];
+            #pragma omp for
+            for (std::size_t i = 0u; i < nsi; ++i)
+            {
+                if(ctx.ctl->expired())
+                    continue;
+                if(ctx.adaptive) {
+                    adaptiveci(sws, subIntervals[i], delta, x, ctx,
+                            chebyBands, tol, ctx.nmin, Nmax);
+                } else {
+                    // find the Chebyshev nodes scaled to the current subinterval
+                    chgvar(sws.siCN, chebyNodes, subIntervals[i].first,
+                            subIntervals[i].second);
 
-        for(std::size_t i{0u}; i < pExs.size(); ++i)
-            for(std::size_t j{0u}; j < pExs[i].size(); ++j)
-                pEx.push_back(pExs[i][j]);
+                    // compute the Chebyshev interpolation function values on the
+                    // current subinterval
+                    comperror(sws.fx, sws.siCN, delta, x, ctx, chebyBands);
 
-        std::size_t startingOffset = potentialExtrema.size();
-        potentialExtrema.resize(potentialExtrema.size() + pEx.size());
-        #pragma omp parallel for
-        for(std::size_t i = 0u; i < pEx.size(); ++i)
+                    // compute the values of the CI coefficients
+                    chebcoeffs(sws.c, sws.fx);
+                }
+                // and those of its derivative
+                diffcoeffs(sws.dc, sws.c);
+
+                // solve the corresponding eigenvalue problem and determine the
+                // local extrema situated in the current subinterval
+                roots(sws.r, sws.dc, dom);
+                if(!sws.r.empty()) {
+                    chgvar(sws.r, sws.r,
+                            subIntervals[i].first, subIntervals[i].second);
+                    for (std::size_t j{0u}; j < sws.r.size(); ++j)
+                        sws.cand.push_back(sws.r[j]);
+                }
+                sws.cand.push_back(subIntervals[i].first);
+                sws.cand.push_back(subIntervals[i].second);
+            }
+        }
+        if(ctx.ctl->expired())
+            throw interrupt_t{};
+
+        // gather the candidates of all the subintervals
+        pEx.clear();
+        for(auto& it : ws.sub)
+            pEx.insert(pEx.end(), it.cand.begin(), it.cand.end());
+        std::size_t pExSize = pEx.size();
+        if(potentialExtrema.size() < pCount + pExSize)
+            potentialExtrema.resize(pCount + pExSize);
+
+        std::size_t startingOffset = pCount;
+        pCount += pExSize;
+        // evaluate the error at the candidates in blocks, so that the
+        // batch barycentric routine can work on several points at once
+        const std::size_t blockSize{64u};
+        std::size_t nblocks = (pExSize + blockSize - 1u) / blockSize;
+        #pragma omp parallel if(!omp_in_parallel())
         {
-            #ifdef HAVE_MPFR
-                mpfr_prec_t prevPrec = mpfr::mpreal::get_default_prec();
-                mpfr::mpreal::set_default_prec(prec);
-            #endif
-            T valBuffer;
-            comperror(valBuffer, pEx[i],
-                    delta, x, C, w, chebyBands);
-            potentialExtrema[startingOffset + i] = std::make_pair(pEx[i], valBuffer);
-            #ifdef HAVE_MPFR
-                mpfr::mpreal::set_default_prec(prevPrec);
-            #endif
+            precscope_t<T> scope(ctx.prec);
+            subws_t<T>& sws = ws.sub[omp_get_thread_num()];
+            #pragma omp for
+            for(std::size_t b = 0u; b < nblocks; ++b)
+            {
+                std::size_t first = b * blockSize;
+                std::size_t last = std::min(first + blockSize, pExSize);
+                sws.pts.assign(pEx.begin() + first, pEx.begin() + last);
+                comperror(sws.err, sws.pts, delta, x, ctx, chebyBands);
+                for(std::size_t i{first}; i < last; ++i)
+                {
+                    potentialExtrema[startingOffset + i].first = pEx[i];
+                    potentialExtrema[startingOffset + i].second = sws.err[i - first];
+                }
+            }
         }
 
         // sort list of potential extrema in increasing order
-        std::sort(potentialExtrema.begin(), potentialExtrema.end(),
+        std::sort(potentialExtrema.begin(), potentialExtrema.begin() + pCount,
                 [](const std::pair<T, T>& lhs,
                 const std::pair<T, T>& rhs) {
                     return lhs.first < rhs.first;
                 });
 
-        eigenExtrema.clear();
         std::size_t extremaIt{0u};
-        std::vector<std::pair<T, T>> alternatingExtrema;
+        std::vector<std::pair<T, T>>& alternatingExtrema = ws.alternatingExtrema;
+        alternatingExtrema.clear();
         T minError = INT_MAX;
         T maxError = INT_MIN;
         T absError;
 
-        while (extremaIt < potentialExtrema.size())
+        while (extremaIt < pCount)
         {
-            std::pair<T, T> maxErrorPoint;
-            maxErrorPoint = potentialExtrema[extremaIt];
-            while(extremaIt < potentialExtrema.size() - 1u &&
-                (pmmath::signbit(maxErrorPoint.second) ==
+            std::size_t maxErrorIt = extremaIt;
+            while(extremaIt < pCount - 1u &&
+                (pmmath::signbit(potentialExtrema[maxErrorIt].second) ==
                 pmmath::signbit(potentialExtrema[extremaIt + 1u].second)))
             {
                 ++extremaIt;
-                if (pmmath::fabs(maxErrorPoint.second) < 
+                if (pmmath::fabs(potentialExtrema[maxErrorIt].second) <
                     pmmath::fabs(potentialExtrema[extremaIt].second))
-                    maxErrorPoint = potentialExtrema[extremaIt];
+                    maxErrorIt = extremaIt;
             }
-            if (pmmath::isfinite(maxErrorPoint.second)) {
-                alternatingExtrema.push_back(maxErrorPoint);
+            if (pmmath::isfinite(potentialExtrema[maxErrorIt].second)) {
+                alternatingExtrema.push_back(potentialExtrema[maxErrorIt]);
             }
             ++extremaIt;
         }
-        std::vector<std::pair<T, T>> bufferExtrema;
 
         if(alternatingExtrema.size() < x.size())
         {
@@ -474,7 +927,7 @@ namespace pm {
                 << "TRIGGER: Not enough alternating extrema\n"
                 << "POSSIBLE CAUSE: nmax too small\n";
             convergenceOrder = 2.0;
-            throw std::runtime_error(message.str());
+            throw missingextrema_t(message.str());
         }
         else if (alternatingExtrema.size() > x.size())
         {
@@ -492,29 +945,23 @@ namespace pm {
                     }
                     x2.push_back(alternatingExtrema[alternatingExtrema.size() - 1u].first);
                     T delta1, delta2;
-                    compdelta(delta1, x1, chebyBands);
-                    compdelta(delta2, x2, chebyBands);
+                    refdelta(delta1, x1, chebyBands, ctx);
+                    refdelta(delta2, x2, chebyBands, ctx);
                     delta1 = pmmath::fabs(delta1);
                     delta2 = pmmath::fabs(delta2);
-                    std::size_t sIndex{1u};
                     if(delta1 > delta2)
-                        sIndex = 0u;
-                    for(std::size_t i{sIndex}; i < alternatingExtrema.size() + sIndex - 1u; ++i)
-                        bufferExtrema.push_back(alternatingExtrema[i]);
-                    alternatingExtrema = bufferExtrema;
-                    bufferExtrema.clear();
+                        alternatingExtrema.pop_back();
+                    else
+                        alternatingExtrema.erase(alternatingExtrema.begin());
                 }
                 else
                 {
                     T abs1 = pmmath::fabs(alternatingExtrema[0u].second);
                     T abs2 = pmmath::fabs(alternatingExtrema[alternatingExtrema.size() - 1u].second);
-                    std::size_t sIndex = 0u;
                     if (abs1 < abs2)
-                        sIndex = 1u;
-                    for(std::size_t i{sIndex}; i < alternatingExtrema.size() + sIndex - 1u; ++i)
-                        bufferExtrema.push_back(alternatingExtrema[i]);
-                    alternatingExtrema = bufferExtrema;
-                    bufferExtrema.clear();
+                        alternatingExtrema.erase(alternatingExtrema.begin());
+                    else
+                        alternatingExtrema.pop_back();
                 }
             }
 
@@ -524,7 +971,7 @@ namespace pm {
                 std::size_t toRemoveIndex{0u};
                 T minValToRemove;
                 // change removal rule for extra extrema in case cycling is detected
-                if(!cycle) {
+                if(!ctx.cycle) {
                     minValToRemove = pmmath::fmin(pmmath::fabs(alternatingExtrema[0u].second),
                                                 pmmath::fabs(alternatingExtrema[1u].second));
                 } else {
@@ -534,7 +981,7 @@ namespace pm {
                 T removeBuffer;
                 for (std::size_t i{1u}; i < alternatingExtrema.size() - 1u; ++i)
                 {
-                    if(!cycle) {
+                    if(!ctx.cycle) {
                         removeBuffer = pmmath::fmin(pmmath::fabs(alternatingExtrema[i].second),
                                     pmmath::fabs(alternatingExtrema[i + 1u].second));
                     } else {
@@ -547,15 +994,11 @@ namespace pm {
                         toRemoveIndex  = i;
                     }
                 }
-                for (std::size_t i{0u}; i < toRemoveIndex; ++i)
-                    bufferExtrema.push_back(alternatingExtrema[i]);
-                for (std::size_t i{toRemoveIndex + 2u}; i < alternatingExtrema.size(); ++i)
-                    bufferExtrema.push_back(alternatingExtrema[i]);
-                alternatingExtrema = bufferExtrema;
-                bufferExtrema.clear();
+                alternatingExtrema.erase(alternatingExtrema.begin() + toRemoveIndex,
+                        alternatingExtrema.begin() + toRemoveIndex + 2u);
             }
-            if(cycle)
-                cycle = false;
+            if(ctx.cycle)
+                ctx.cycle = false;
         }
         if (alternatingExtrema.size() < x.size()) {
             status = status_t::STATUS_EXCHANGE_FAILURE;
@@ -564,13 +1007,14 @@ namespace pm {
                 << "TRIGGER: Not enough alternating extrema\n"
                 << "POSSIBLE CAUSE: nmax too small\n";
             convergenceOrder = 2.0;
-            throw std::runtime_error(message.str());
+            throw missingextrema_t(message.str());
         }
 
-        for (auto& it : alternatingExtrema)
+        eigenExtrema.resize(alternatingExtrema.size());
+        for (std::size_t i{0u}; i < alternatingExtrema.size(); ++i)
         {
-            eigenExtrema.push_back(it.first);
-            absError = pmmath::fabs(it.second);
+            eigenExtrema[i] = alternatingExtrema[i].first;
+            absError = pmmath::fabs(alternatingExtrema[i].second);
             minError = pmmath::fmin(minError, absError);
             maxError = pmmath::fmax(maxError, absError);
         }
@@ -595,20 +1039,23 @@ namespace pm {
                 ++chebyBands[bIndex].xs;
             }
         }
-    #ifdef HAVE_MPFR
-        mpfr::mpreal::set_default_prec(prevPrec);
-    #endif
     }
 
 
     // REMARK: remember that this routine assumes that the information
     // pertaining to the reference x and the frequency bands (i.e., the
     // number of reference values inside each band) is given at the
-    // beginning of the execution
+    // beginning of the execution; if rung is set, the iterations stop as
+    // soon as the convergence stagnates and only the reference is computed
+    // (the run is a step of the precision ladder, see exchange); once
+    // the observer has asked to stop, a run only does the one iteration
+    // needed to get the state of its reference, and once the design is
+    // interrupted, it does none and keeps the best reference it has
     template<typename T>
-    pmoutput_t<T> exchange(std::vector<T>& x,
+    pmoutput_t<T> exchangerun(std::vector<T>& x,
             std::vector<band_t<T>>& chebyBands, double eps,
-            std::size_t Nmax, unsigned long prec)
+            std::size_t Nmax, unsigned long prec,
+            pmopts_t<T> const& opts, bool rung, runctl_t& ctl)
     {
         pmoutput_t<T> output;
         output.status = status_t::STATUS_UNKNOWN_FAILURE;
@@ -620,33 +1067,127 @@ namespace pm {
                     return lhs < rhs;
                 });
         std::vector<T> startX{x};
-        cycle = false;
-        T qp1 = 0;
-        T qp2 = 0;
+        exchctx_t<T> ctx;
+        ctx.cycle = false;
+        ctx.qp1 = 0;
+        ctx.qp2 = 0;
+        ctx.eps = eps;
+        ctx.adaptive = (Nmax == NMAX_ADAPTIVE);
+        ctx.nmin = ADAPTIVE_NMIN;
+        ctx.nmax = ctx.adaptive ? ADAPTIVE_NMAX : Nmax;
+        ctx.prec = prec;
+        ctx.fmm = opts.bary == bary_t::FMM ||
+            (opts.bary == bary_t::AUTO && fmmauto<T>() &&
+            x.size() >= FMM_AUTO_SIZE);
+        ctx.fmmtol = opts.fmmtol;
+        ctx.sorted = bandsorted(chebyBands);
+        ctx.ctl = &ctl;
+        wsinit(ctx.ws, chebyBands, x.size(), ctx.adaptive ? ctx.nmin : Nmax);
 
         output.q = 1;
+        output.delta = 0;
         output.iter = 0u;
+        T qbest = 1;
+        std::size_t stalled{0u};
+        // reference with the smallest q so far, returned if the design
+        // is interrupted
+        std::vector<T> bestX;
+        T bestQ = 1;
+        if(ctl.armed)
+            bestX = startX;
         do {
+            if(ctl.expired()) {
+                ctl.interrupted = true;
+                break;
+            }
             ++output.iter;
-            extrema(output.status, output.q, output.delta,
-                    output.x, startX, chebyBands, Nmax, prec);
+            for(;;) {
+                try {
+                    extrema(output.status, output.q, output.delta,
+                            output.x, startX, chebyBands, ctx);
+                    break;
+                } catch(missingextrema_t&) {
+                    // in adaptive mode, missing extrema are searched for
+                    // again with denser interpolants
+                    if(!ctx.adaptive || 2u * ctx.nmin > ctx.nmax)
+                        throw;
+                    ctx.nmin *= 2u;
+                } catch(interrupt_t&) {
+                    ctl.interrupted = true;
+                    break;
+                }
+            }
+            // the denser interpolants were only needed for this reference,
+            // the next iteration starts again from the smallest degree
+            ctx.nmin = ADAPTIVE_NMIN;
+            if(ctl.interrupted) {
+                --output.iter;
+                break;
+            }
             startX = output.x;
+            if(ctl.armed && (output.iter == 1u || output.q < bestQ)) {
+                bestX = output.x;
+                bestQ = output.q;
+            }
             if(output.iter == 1u)
-                qp2 = output.q;
+                ctx.qp2 = output.q;
             else if(output.iter == 2u)
-                qp1 = output.q;
+                ctx.qp1 = output.q;
             else {
                 // potential cycling, tweak reference update strategy (if
                 // reference set candidate is large)
-                if(pmmath::fabs(qp2-output.q)/pmmath::fabs(qp2) < eps*1e-5)
-                    cycle = true;
-                qp2 = qp1;
-                qp1 = output.q;
+                if(pmmath::fabs(ctx.qp2-output.q)/pmmath::fabs(ctx.qp2) < ctx.eps*1e-5)
+                    ctx.cycle = true;
+                ctx.qp2 = ctx.qp1;
+                ctx.qp1 = output.q;
+            }
+            if(ctl.stopped)
+                break;
+            if(opts.observer) {
+                pmprogress_t progress;
+                progress.iter = output.iter;
+                progress.q = pmmath::convert<double>(output.q);
+                progress.delta = pmmath::convert<double>(output.delta);
+                progress.refsize = output.x.size();
+                for(auto it = chebyBands.rbegin(); it != chebyBands.rend(); ++it)
+                    progress.bandcount.push_back(it->xs);
+                progress.cycle = ctx.cycle;
+                progress.rung = rung;
+                progress.elapsed = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - ctl.start).count();
+                if(!opts.observer(progress)) {
+                    ctl.stopped = true;
+                    break;
+                }
             }
             if(output.q > 1.0)
                 break;
+            if(rung) {
+                if(output.q < qbest) {
+                    qbest = output.q;
+                    stalled = 0u;
+                } else if(++stalled >= LADDER_PATIENCE) {
+                    break;
+                }
+            }
         } while (output.q > eps && output.iter <= 100u);
         output.status = status_t::STATUS_SUCCESS;
+        if(ctl.interrupted) {
+            output.x = bestX;
+            output.q = bestQ;
+            countBand(chebyBands, output.x);
+        }
+
+        if(rung) {
+            if(!pmmath::isfinite(output.delta) || !pmmath::isfinite(output.q))
+                output.status = status_t::STATUS_CONVERGENCE_WARNING;
+            return output;
+        }
+
+        if(ctl.interrupted)
+            output.status = status_t::STATUS_INTERRUPTED;
+        else if(ctl.stopped && !(output.q <= eps))
+            output.status = status_t::STATUS_CONVERGENCE_WARNING;
 
         if(pmmath::isnan(output.delta) || pmmath::isnan(output.q)) {
             output.status = status_t::STATUS_CONVERGENCE_WARNING;
@@ -667,18 +1208,32 @@ namespace pm {
         output.h.resize(degree + 1u);
         std::vector<T> finalC(output.x.size());
         std::vector<T> finalAlpha(output.x.size());
-        baryweights(finalAlpha, output.x);
+        if(ctx.fmm) {
+            fmminit(ctx.ws.tree, output.x, ctx.fmmtol);
+            fmmweights(finalAlpha, ctx.ws.tree);
+        } else {
+            baryweights(finalAlpha, output.x);
+        }
         T finalDelta = output.delta;
         output.delta = pmmath::fabs(output.delta);
-        compc(finalC, finalDelta, output.x, chebyBands);
-        std::vector<T> finalChebyNodes(degree + 1);
-        equipts(finalChebyNodes, degree + 1);
-        cos(finalChebyNodes, finalChebyNodes);
+        std::vector<T> finalD, finalW;
+        idealvals(finalD, finalW, output.x, chebyBands);
+        if(ctl.interrupted) {
+            // the reference is not the one of the last computed delta
+            compdelta(finalDelta, finalAlpha, finalD, finalW);
+            output.delta = pmmath::fabs(finalDelta);
+        }
+        compc(finalC, finalDelta, finalD, finalW);
+        std::shared_ptr<const std::vector<T>> finalChebyNodes = chebpts<T>(degree + 1u);
         std::vector<T> fv(degree + 1);
+        if(ctx.fmm) {
+            fmmcharges(ctx.ws.tree, finalC);
+            approx(fv, *finalChebyNodes, ctx.ws.tree);
+        } else {
+            approx(fv, *finalChebyNodes, output.x, finalC, finalAlpha);
+        }
 
         for (std::size_t i{0u}; i < fv.size(); ++i) {
-            approx(fv[i], finalChebyNodes[i], output.x,
-                    finalC, finalAlpha);
             if (!pmmath::isfinite(fv[i])) {
                 output.status = status_t::STATUS_COEFFICIENT_SET_INVALID;
                 std::stringstream message;
@@ -695,6 +1250,88 @@ namespace pm {
         return output;
     }
 
+    // exchange algorithm with the precision ladder: if it is enabled and
+    // there is a lower precision than T, the reference is first computed
+    // in that precision (recursively, so that an MPFR design starts in
+    // double) until the convergence stagnates, and the iterations are then
+    // continued in T from it; if anything goes wrong along the way, the
+    // design is redone in T from the initial reference
+    template<typename T>
+    pmoutput_t<T> exchangeladder(std::vector<T>& x,
+            std::vector<band_t<T>>& chebyBands, double eps,
+            std::size_t Nmax, unsigned long prec,
+            pmopts_t<T> const& opts, bool rung, runctl_t& ctl)
+    {
+        using L = typename lowerprec<T>::type;
+        if(!opts.ladder || std::is_same<L, T>::value)
+            return exchangerun(x, chebyBands, eps, Nmax, prec, opts, rung, ctl);
+
+        std::vector<T> startX{x};
+        std::vector<std::size_t> startXs;
+        for(auto& it : chebyBands)
+            startXs.push_back(it.xs);
+        try {
+            std::vector<L> lx(x.size());
+            for(std::size_t i{0u}; i < x.size(); ++i)
+                lx[i] = pmmath::convert<L>(x[i]);
+            std::vector<band_t<L>> lbands;
+            bandcast(lbands, chebyBands);
+            pmopts_t<L> lopts;
+            lopts.bary = opts.bary;
+            lopts.fmmtol = opts.fmmtol;
+            lopts.ladder = true;
+            lopts.observer = opts.observer;
+            lopts.cancel = opts.cancel;
+            lopts.deadline = opts.deadline;
+            pmoutput_t<L> loutput = exchangeladder(lx, lbands, eps, Nmax,
+                    prec, lopts, true, ctl);
+            if(loutput.status == status_t::STATUS_SUCCESS &&
+                    loutput.x.size() == x.size()) {
+                for(std::size_t i{0u}; i < x.size(); ++i)
+                    x[i] = pmmath::convert<T>(loutput.x[i]);
+                std::sort(x.begin(), x.end());
+                // the band edges are rounded differently in the two
+                // precisions, keep the points on the edges inside the bands
+                snapbands(x, chebyBands);
+                countBand(chebyBands, x);
+                pmoutput_t<T> output = exchangerun(x, chebyBands, eps,
+                        Nmax, prec, opts, rung, ctl);
+                if(ctl.stopped || ctl.interrupted ||
+                        (output.status == status_t::STATUS_SUCCESS &&
+                        (rung || output.q <= eps))) {
+                    if(ctl.interrupted && output.iter == 0u)
+                        output.q = pmmath::convert<T>(loutput.q);
+                    output.iter += loutput.iter;
+                    return output;
+                }
+            }
+        } catch(std::runtime_error&) {
+        }
+
+        x = startX;
+        for(std::size_t i{0u}; i < chebyBands.size(); ++i)
+            chebyBands[i].xs = startXs[i];
+        return exchangerun(x, chebyBands, eps, Nmax, prec, opts, rung, ctl);
+    }
+
+    template<typename T>
+    pmoutput_t<T> exchange(std::vector<T>& x,
+            std::vector<band_t<T>>& chebyBands, double eps,
+            std::size_t Nmax, unsigned long prec,
+            pmopts_t<T> const& opts)
+    {
+        precscope_t<T> scope(prec);
+        runctl_t ctl;
+        ctl.start = std::chrono::steady_clock::now();
+        ctl.stopped = false;
+        ctl.cancel = opts.cancel;
+        ctl.deadline = opts.deadline;
+        ctl.armed = opts.cancel != nullptr ||
+            opts.deadline != std::chrono::steady_clock::time_point::max();
+        ctl.interrupted = false;
+        return exchangeladder(x, chebyBands, eps, Nmax, prec, opts, false, ctl);
+    }
+
     template<typename T>
     void parseSpecification(status_t& status,
                 std::vector<T> const& f,
@@ -763,8 +1400,12 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
+        // every number created by the design (in this thread and in the
+        // worker threads of exchange) has the precision prec
+        precscope_t<T> scope(prec);
         pmoutput_t<T> output;
         output.status = status_t::STATUS_UNKNOWN_FAILURE;
 
@@ -803,40 +1444,17 @@ namespace pm {
                 }
             }
             for(std::size_t i{0u}; i < fbands.size(); ++i) {
-                fbands[i].part.push_back(T(pmmath::const_pi<T>() * f[2u*bIdx[i][0u]]));
+                std::vector<T> freq, amp;
+                freq.push_back(T(pmmath::const_pi<T>() * f[2u*bIdx[i][0u]]));
                 for(std::size_t j{0u}; j < bIdx[i].size(); ++j) {
-                    fbands[i].part.push_back(T(pmmath::const_pi<T>() * f[2u*bIdx[i][j]+1u]));
+                    freq.push_back(T(pmmath::const_pi<T>() * f[2u*bIdx[i][j]+1u]));
+                    amp.push_back(a[2u*bIdx[i][j]]);
+                    amp.push_back(a[2u*bIdx[i][j]+1u]);
                 }
-            }
-            for(std::size_t i{0u}; i < fbands.size(); ++i) {
-                fbands[i].start = fbands[i].part[0u];
-                fbands[i].stop  = fbands[i].part[fbands[i].part.size()-1u];
-                fbands[i].space = space_t::FREQ;
-
-                fbands[i].amplitude = [i, &a, &bIdx, &fbands](space_t space, T x) -> T {
-                    if(space == space_t::CHEBY)
-                        x = pmmath::acos(x);
-                    for(std::size_t j{0u}; j < bIdx[i].size(); ++j) {
-                        if(fbands[i].part[j]*(1.0-1e-12) <= x &&
-                        x <= fbands[i].part[j+1u]*(1.0+1e-12)) {
-                            if(a[2u*bIdx[i][j]] != a[2u*bIdx[i][j]+1u]) {
-                                return ((x-fbands[i].part[j]) * a[2u*bIdx[i][j]+1u] -
-                                        (x-fbands[i].part[j+1u]) * a[2u*bIdx[i][j]]) /
-                                        (fbands[i].part[j+1u] - fbands[i].part[j]);
-                            } else {
-                                return a[2u*bIdx[i][j]];
-                            }
-                        }
-                    }
-                    // this should never happen
-                    return a[2u*bIdx[i][0u]];
-                };
-                fbands[i].weight = [i, &w, &bIdx](space_t, T x) -> T {
-                    return w[bIdx[i][0u]];
-                };
+                pwlinit(fbands[i], freq, amp, w[bIdx[i][0u]]);
             }
 
-            return firpm<T>(n, fbands, eps, nmax, strategy, depth, rstrategy, prec);
+            return firpm<T>(n, fbands, eps, nmax, strategy, depth, rstrategy, prec, opts);
         }
         catch (std::domain_error &err) {
             std::cerr << "Invalid specification detected:" << std::endl;
@@ -863,8 +1481,10 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
+        precscope_t<T> scope(prec);
         pmoutput_t<T> output;
         output.status = status_t::STATUS_UNKNOWN_FAILURE;
 
@@ -884,6 +1504,9 @@ namespace pm {
                             ? pi * T(0.9999)
                             : (b.start + pi) / 2;
 
+                    // bands with a piecewise-linear description get the same
+                    // correction when they are evaluated directly
+                    b.pwl.halfcos = true;
                     auto user_amp = b.amplitude;
                     auto user_wt  = b.weight;
                     b.amplitude = [user_amp](space_t space, T x) -> T {
@@ -919,7 +1542,11 @@ namespace pm {
             if(fbands.size() > (deg + 2u) / 4)
                 strategy = init_t::AFP;
 
-            switch(strategy) {
+            if(!opts.x0.empty()) {
+                // warm start, replaces the initialization strategy
+                warmstart(output.status, x, opts.x0, opts.x0space, cbands, deg + 2u);
+                output = exchange(x, cbands, eps, nmax, prec, opts);
+            } else switch(strategy) {
                 case init_t::UNIFORM:
                 {
                     if (fbands.size() <= (deg + 2u) / 4) {
@@ -944,7 +1571,7 @@ namespace pm {
                         }
                         countBand(cbands, x);
                     }
-                    output = exchange(x, cbands, eps, nmax, prec);
+                    output = exchange(x, cbands, eps, nmax, prec, opts);
                 } break;
                 case init_t::SCALING:
                 {
@@ -977,7 +1604,7 @@ namespace pm {
                             }
                             countBand(cbands, x);
                         }
-                        output = exchange(x, cbands, eps, nmax, prec);
+                        output = exchange(x, cbands, eps, nmax, prec, opts);
                     } else { // AFP-based strategy
                         std::vector<T> mesh;
                         wam(mesh, cbands, sdegs[0]);
@@ -993,13 +1620,13 @@ namespace pm {
                             throw std::runtime_error(message.str());
                         }
                         countBand(cbands, x);
-                        output = exchange(x, cbands, eps, nmax, prec);
+                        output = exchange(x, cbands, eps, nmax, prec, opts);
                     }
                     for(std::size_t i{1u}; i <= depth && output.q <= 0.5; ++i) {
                         x.clear();
                         refscaling(output.status, x, cbands, fbands, sdegs[i]+2u,
                                         output.x, cbands, fbands);
-                        output = exchange(x, cbands, eps, nmax, prec);
+                        output = exchange(x, cbands, eps, nmax, prec, opts);
                     }
                 } break;
                 default: { // AFP-based initialization
@@ -1016,7 +1643,7 @@ namespace pm {
                         throw std::runtime_error(message.str());
                     }
                     countBand(cbands, x);
-                    output = exchange(x, cbands, eps, nmax, prec);
+                    output = exchange(x, cbands, eps, nmax, prec, opts);
                 }
             }
 
@@ -1037,7 +1664,9 @@ namespace pm {
                     h[deg+1u-i] = h[deg+i] = (output.h[i-1u] + output.h[i]) / 4u;
             }
             output.h = h;
-            output.status = status_t::STATUS_SUCCESS;
+            if(output.status != status_t::STATUS_CONVERGENCE_WARNING &&
+                    output.status != status_t::STATUS_INTERRUPTED)
+                output.status = status_t::STATUS_SUCCESS;
         }
         catch (std::domain_error &err) {
             std::cerr << "Invalid specification detected:" << std::endl;
@@ -1066,14 +1695,15 @@ namespace pm {
                 std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
         if( n < 2u*f.size()) {
             std::cerr << "WARNING: too small filter length to use reference scaling." << std::endl
                 << "Switching to a uniform initialization strategy." << std::endl;
-            return firpm<T>(n, f, a, w, eps, nmax, init_t::UNIFORM, depth, rstrategy, prec);
+            return firpm<T>(n, f, a, w, eps, nmax, init_t::UNIFORM, depth, rstrategy, prec, opts);
         } else {
-            return firpm<T>(n, f, a, w, eps, nmax, init_t::SCALING, depth, rstrategy, prec);
+            return firpm<T>(n, f, a, w, eps, nmax, init_t::SCALING, depth, rstrategy, prec, opts);
         }
     }
 
@@ -1083,9 +1713,10 @@ namespace pm {
                 std::vector<T>const& a,
                 std::vector<T>const& w,
                 double eps, std::size_t nmax,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
-        return firpm<T>(n, f, a, w, eps, nmax, init_t::AFP, 0u, init_t::AFP, prec);
+        return firpm<T>(n, f, a, w, eps, nmax, init_t::AFP, 0u, init_t::AFP, prec, opts);
     }
 
     template<typename T>
@@ -1099,8 +1730,10 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
+        precscope_t<T> scope(prec);
         pmoutput_t<T> output;
         output.status = status_t::STATUS_UNKNOWN_FAILURE;
 
@@ -1295,7 +1928,11 @@ namespace pm {
             if(fbands.size() > (deg + 2u) / 4)
                 strategy = init_t::AFP;
 
-            switch(strategy) {
+            if(!opts.x0.empty()) {
+                // warm start, replaces the initialization strategy
+                warmstart(output.status, x, opts.x0, opts.x0space, cbands, deg + 2u);
+                output = exchange(x, cbands, eps, nmax, prec, opts);
+            } else switch(strategy) {
                 case init_t::UNIFORM:
                 {
                     if (fbands.size() <= (deg + 2u) / 4) {
@@ -1320,7 +1957,7 @@ namespace pm {
                         }
                         countBand(cbands, x);
                     }
-                    output = exchange(x, cbands, eps, nmax, prec);
+                    output = exchange(x, cbands, eps, nmax, prec, opts);
                 } break;
                 case init_t::SCALING:
                 {
@@ -1351,7 +1988,7 @@ namespace pm {
                             }
                             countBand(cbands, x);
                         }
-                        output = exchange(x, cbands, eps, nmax);
+                        output = exchange(x, cbands, eps, nmax, prec, opts);
                     } else { // AFP-based strategy
                         std::vector<T> mesh;
                         wam(mesh, cbands, sdegs[0]);
@@ -1366,13 +2003,13 @@ namespace pm {
                             throw std::runtime_error(message.str());
                         }
                         countBand(cbands, x);
-                        output = exchange(x, cbands, eps, nmax);
+                        output = exchange(x, cbands, eps, nmax, prec, opts);
                     }
                     for(std::size_t i{1u}; i <= depth && output.q <= 0.5; ++i) {
                         x.clear();
                         refscaling(output.status, x, cbands, fbands, sdegs[i]+2u,
                                         output.x, cbands, fbands);
-                        output = exchange(x, cbands, eps, nmax, prec);
+                        output = exchange(x, cbands, eps, nmax, prec, opts);
                     }
                 } break;
                 default: { // AFP-based initialization
@@ -1389,7 +2026,7 @@ namespace pm {
                         throw std::runtime_error(message.str());
                     }
                     countBand(cbands, x);
-                    output = exchange(x, cbands, eps, nmax, prec);
+                    output = exchange(x, cbands, eps, nmax, prec, opts);
                 }
             }
 
@@ -1454,14 +2091,15 @@ namespace pm {
                 double eps,
                 std::size_t nmax, std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
         if( n < 2u*f.size()) {
             std::cerr << "WARNING: too small filter length to use reference scaling." << std::endl
                 << "Switching to a uniform initialization strategy" << std::endl;
-            return firpm<T>(n, f, a, w, type, eps, nmax, init_t::UNIFORM, depth, rstrategy, prec);
+            return firpm<T>(n, f, a, w, type, eps, nmax, init_t::UNIFORM, depth, rstrategy, prec, opts);
         } else {
-            return firpm<T>(n, f, a, w, type, eps, nmax, init_t::SCALING, depth, rstrategy, prec);
+            return firpm<T>(n, f, a, w, type, eps, nmax, init_t::SCALING, depth, rstrategy, prec, opts);
         }
 
     }
@@ -1474,10 +2112,338 @@ namespace pm {
                 filter_t type,
                 double eps,
                 std::size_t nmax,
-                unsigned long prec)
+                unsigned long prec,
+                pmopts_t<T> const& opts)
     {
         return firpm<T>(n, f, a, w, type, eps,
-                    nmax, init_t::AFP, 0u, init_t::AFP, prec);
+                    nmax, init_t::AFP, 0u, init_t::AFP, prec, opts);
+    }
+
+    template<typename T>
+    pmoutput_t<T> firpmspec(pmspec_t<T> const& spec)
+    {
+        if(spec.antisym)
+            return firpm<T>(spec.n, spec.f, spec.a, spec.w, spec.type,
+                    spec.eps, spec.nmax, spec.strategy, spec.depth,
+                    spec.rstrategy, spec.prec, spec.opts);
+        return firpm<T>(spec.n, spec.f, spec.a, spec.w,
+                spec.eps, spec.nmax, spec.strategy, spec.depth,
+                spec.rstrategy, spec.prec, spec.opts);
+    }
+
+    namespace {
+
+    // wraps the observer of a design run by firpm_batch, firpm_sweep or
+    // firpmord, so that the observers of the designs running at the same
+    // time are called one at a time
+    template<typename T>
+    void serialobs(pmopts_t<T>& opts, std::mutex& mutex)
+    {
+        if(!opts.observer)
+            return;
+        auto observer = std::move(opts.observer);
+        opts.observer = [observer, &mutex](pmprogress_t const& progress) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return observer(progress);
+        };
+    }
+
+    // maps the reference x (in [-1,1]) of a design with the band edges f
+    // onto the band edges g (normalized frequencies, as given to firpm):
+    // each point keeps its relative position inside its band. The points
+    // are returned in [0,pi], and left in place if the number of bands
+    // changed.
+    template<typename T>
+    std::vector<T> mapref(std::vector<T> const& x,
+            std::vector<T> const& f, std::vector<T> const& g)
+    {
+        std::vector<T> omega;
+        omega.reserve(x.size());
+        for(auto const& it : x) {
+            T w = pmmath::acos(it) / pmmath::const_pi<T>();
+            if(f.size() == g.size()) {
+                T dist = 0;
+                std::size_t bi = 2u * nearestband(dist, w, f);
+                T t = 0;
+                if(f[bi + 1u] != f[bi])
+                    t = pmmath::fmin(pmmath::fmax((w - f[bi]) / (f[bi + 1u] - f[bi]),
+                                T(0)), T(1));
+                w = g[bi] + (g[bi + 1u] - g[bi]) * t;
+            }
+            omega.push_back(pmmath::const_pi<T>() * w);
+        }
+        return omega;
+    }
+
+    } // anonymous namespace
+
+    template<typename T>
+    std::vector<pmoutput_t<T>> firpm_batch(std::vector<pmspec_t<T>> const& specs,
+                std::size_t nsplit)
+    {
+        std::vector<pmoutput_t<T>> outputs(specs.size());
+
+        // small designs are run concurrently (the parallel regions of their
+        // iterations then run on the thread of the design alone), the
+        // largest ones first so that the load stays balanced at the end;
+        // large designs keep all the threads for their own extrema search
+        std::vector<std::size_t> small, large;
+        for(std::size_t i{0u}; i < specs.size(); ++i) {
+            if(specs[i].n < nsplit)
+                small.push_back(i);
+            else
+                large.push_back(i);
+        }
+        std::stable_sort(small.begin(), small.end(),
+                [&specs](std::size_t lhs, std::size_t rhs) {
+                    return specs[lhs].n > specs[rhs].n;
+                });
+
+        std::mutex obsmutex;
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(std::size_t i = 0u; i < small.size(); ++i) {
+            pmspec_t<T> const& ispec = specs[small[i]];
+            if(!ispec.opts.observer) {
+                outputs[small[i]] = firpmspec(ispec);
+                continue;
+            }
+            pmspec_t<T> wspec{ispec};
+            serialobs(wspec.opts, obsmutex);
+            outputs[small[i]] = firpmspec(wspec);
+        }
+
+        for(auto idx : large)
+            outputs[idx] = firpmspec(specs[idx]);
+
+        return outputs;
+    }
+
+    template<typename T>
+    std::vector<pmoutput_t<T>> firpm_sweep(
+                std::function<pmspec_t<T>(T const&)> const& spec,
+                std::vector<T> const& params, std::size_t nchains)
+    {
+        // the specifications are built by the calling thread, with its
+        // precision, the callback does not need to be thread safe
+        std::vector<pmspec_t<T>> specs;
+        specs.reserve(params.size());
+        std::mutex obsmutex;
+        for(auto const& it : params) {
+            specs.push_back(spec(it));
+            serialobs(specs.back().opts, obsmutex);
+        }
+
+        std::vector<pmoutput_t<T>> outputs(specs.size());
+        nchains = std::max<std::size_t>(1u, std::min(nchains, specs.size()));
+
+        // each chain designs a contiguous run of the parameter values, its
+        // first design from the initialization strategy of its
+        // specification, the next ones from the reference of the previous
+        // design moved onto their band edges
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(std::size_t c = 0u; c < nchains; ++c) {
+            std::size_t first = c * specs.size() / nchains;
+            std::size_t last = (c + 1u) * specs.size() / nchains;
+            for(std::size_t i{first}; i < last; ++i) {
+                if(i > first && specs[i].opts.x0.empty() &&
+                        outputs[i - 1u].status == status_t::STATUS_SUCCESS) {
+                    precscope_t<T> scope(specs[i].prec);
+                    pmspec_t<T> wspec{specs[i]};
+                    wspec.opts.x0 = mapref(outputs[i - 1u].x,
+                            specs[i - 1u].f, specs[i].f);
+                    wspec.opts.x0space = space_t::FREQ;
+                    outputs[i] = firpmspec(wspec);
+                    // a poor start is retried from scratch
+                    if(outputs[i].status == status_t::STATUS_SUCCESS)
+                        continue;
+                }
+                outputs[i] = firpmspec(specs[i]);
+            }
+        }
+
+        return outputs;
+    }
+
+    double ripple2dev(double db)
+    {
+        double r = std::pow(10.0, db / 20.0);
+        return (r - 1.0) / (r + 1.0);
+    }
+
+    double atten2dev(double db)
+    {
+        return std::pow(10.0, -db / 20.0);
+    }
+
+    // Kaiser's estimate of the order of a filter with the bands f and the
+    // deviations dev, taken on its most demanding transition
+    template<typename T>
+    double kaiserord(std::vector<T> const& f, std::vector<double> const& dev)
+    {
+        double n{0.0};
+        for(std::size_t i{1u}; i < dev.size(); ++i) {
+            // transition width in cycles per sample
+            double df = pmmath::convert<double>(f[2u * i] - f[2u * i - 1u]) / 2.0;
+            if(df <= 0.0)
+                continue;
+            double d = -20.0 * std::log10(std::sqrt(dev[i - 1u] * dev[i]));
+            n = std::max(n, (d - 13.0) / (14.6 * df));
+        }
+        return n;
+    }
+
+    template<typename T>
+    pmoutput_t<T> firpmord(std::vector<T> const& f,
+                std::vector<T> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<T> const& opts)
+    {
+        pmoutput_t<T> output{};
+        if(dev.size() * 2u != f.size()) {
+            output.status = status_t::STATUS_WEIGHT_VECTOR_MISMATCH;
+            std::cerr << "ERROR: Deviation vector size does not match "
+                << "the number of bands" << std::endl;
+            return output;
+        }
+        for(auto const& it : dev) {
+            if(!(it > 0.0)) {
+                output.status = status_t::STATUS_WEIGHT_NEGATIVE;
+                std::cerr << "ERROR: Deviations must be positive" << std::endl;
+                return output;
+            }
+        }
+
+        pmspec_t<T> spec;
+        spec.f = f;
+        spec.a = a;
+        spec.eps = eps;
+        spec.nmax = nmax;
+        spec.prec = prec;
+        spec.opts = opts;
+        std::mutex obsmutex;
+        serialobs(spec.opts, obsmutex);
+        double dmax = *std::max_element(dev.begin(), dev.end());
+        {
+            precscope_t<T> scope(prec);
+            for(auto const& it : dev)
+                spec.w.push_back(T(dmax / it));
+        }
+
+        // type II filters vanish at pi, only type I ones can have a
+        // nonzero amplitude there
+        std::size_t step = (f.back() == 1 && a.back() != 0) ? 2u : 1u;
+        std::size_t nlow = std::max<std::size_t>(f.size(), 3u);
+        nlow += (nlow % step);
+        std::size_t n0 = (std::size_t)std::ceil(kaiserord(f, dev));
+        n0 = std::max(n0 + (n0 % step), nlow);
+        std::size_t nlimit = 16u * n0 + 1000u;
+        std::size_t width = std::max(1, std::min(omp_get_max_threads(), 8));
+
+        std::map<std::size_t, pmoutput_t<T>> done;
+        auto feasible = [&](pmoutput_t<T> const& o) {
+            return o.status == status_t::STATUS_SUCCESS && o.delta <= dmax;
+        };
+        std::size_t growth{1u};
+        std::vector<std::size_t> orders;
+        while(true) {
+            // smallest order that meets the deviations, and largest one
+            // below it that does not
+            std::size_t best{0u}, below{0u};
+            bool found{false};
+            for(auto const& it : done) {
+                if(feasible(it.second)) {
+                    best = it.first;
+                    found = true;
+                    break;
+                }
+                below = it.first;
+            }
+
+            orders.clear();
+            if(done.empty()) {
+                // a window of orders around the estimate
+                std::size_t start = n0 - std::min(n0 - nlow, (width / 2u) * step);
+                for(std::size_t i{0u}; i < width; ++i)
+                    orders.push_back(start + i * step);
+            } else if(!found) {
+                // widen the steps until the specification is met
+                std::size_t top = done.rbegin()->first;
+                if(top >= nlimit) {
+                    // the largest design that converged, if any
+                    auto it = done.rbegin();
+                    while(std::next(it) != done.rend() &&
+                            it->second.status != status_t::STATUS_SUCCESS)
+                        ++it;
+                    output = it->second;
+                    output.status = status_t::STATUS_ORDER_LIMIT;
+                    return output;
+                }
+                growth *= 2u;
+                for(std::size_t i{1u}; i <= width; ++i)
+                    orders.push_back(top + i * growth * step);
+            } else {
+                std::size_t lo = (below == 0u) ? nlow : below + step;
+                if(lo >= best)
+                    return done[best];
+                // split the bracket evenly at k interior orders (a
+                // bisection for k = 1)
+                std::size_t count = (best - lo) / step;
+                std::size_t k = std::min(count, width);
+                for(std::size_t i{0u}; i < k; ++i) {
+                    std::size_t o = lo + ((i + 1u) * count / (k + 1u)) * step;
+                    if(orders.empty() || orders.back() != o)
+                        orders.push_back(o);
+                }
+            }
+
+            // each trial starts from the reference of the nearest order
+            std::vector<pmspec_t<T>> specs(orders.size(), spec);
+            for(std::size_t i{0u}; i < orders.size(); ++i) {
+                specs[i].n = orders[i];
+                if(!opts.x0.empty())
+                    continue;
+                std::size_t dist = SIZE_MAX;
+                for(auto const& it : done) {
+                    std::size_t d = (it.first > orders[i]) ? it.first - orders[i]
+                                                           : orders[i] - it.first;
+                    if(it.second.status == status_t::STATUS_SUCCESS && d < dist) {
+                        dist = d;
+                        specs[i].opts.x0 = it.second.x;
+                        specs[i].opts.x0space = space_t::CHEBY;
+                    }
+                }
+            }
+
+            std::vector<pmoutput_t<T>> outputs(orders.size());
+            #pragma omp parallel for schedule(dynamic, 1)
+            for(std::size_t i = 0u; i < orders.size(); ++i) {
+                outputs[i] = firpmspec(specs[i]);
+                // a poor start is retried from scratch
+                if(outputs[i].status != status_t::STATUS_SUCCESS &&
+                        !specs[i].opts.x0.empty() && opts.x0.empty()) {
+                    specs[i].opts.x0.clear();
+                    outputs[i] = firpmspec(specs[i]);
+                }
+            }
+            for(std::size_t i{0u}; i < orders.size(); ++i) {
+                // errors in the specification do not depend on the order
+                switch(outputs[i].status) {
+                    case status_t::STATUS_FREQUENCY_INVALID_INTERVAL:
+                    case status_t::STATUS_AMPLITUDE_VECTOR_MISMATCH:
+                    case status_t::STATUS_AMPLITUDE_DISCONTINUITY:
+                    case status_t::STATUS_WEIGHT_NEGATIVE:
+                    case status_t::STATUS_WEIGHT_VECTOR_MISMATCH:
+                    case status_t::STATUS_WEIGHT_DISCONTINUITY:
+                        return outputs[i];
+                    default:
+                        break;
+                }
+                done[orders[i]] = std::move(outputs[i]);
+            }
+        }
     }
 
     /* Explicit instantiations, since template code is not in header */
@@ -1499,7 +2465,8 @@ namespace pm {
                 std::vector<band_t<double>>& chebyBands,
                 double eps,
                 std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     template pmoutput_t<double> firpm<double>(std::size_t n,
                 std::vector<double>const& f,
@@ -1510,7 +2477,8 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     template pmoutput_t<double> firpm<double>(std::size_t n,
                 std::vector<double>const& f,
@@ -1522,7 +2490,8 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     template pmoutput_t<double> firpmRS<double>(std::size_t n,
                 std::vector<double>const& f,
@@ -1531,7 +2500,8 @@ namespace pm {
                 double eps, std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     template pmoutput_t<double> firpmRS<double>(std::size_t n,
                 std::vector<double>const& f,
@@ -1542,14 +2512,16 @@ namespace pm {
                 std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     template pmoutput_t<double> firpmAFP<double>(std::size_t n,
                 std::vector<double>const& f,
                 std::vector<double>const& a,
                 std::vector<double>const& w,
                 double eps, std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     template pmoutput_t<double> firpmAFP<double>(std::size_t n,
                 std::vector<double>const& f,
@@ -1558,7 +2530,28 @@ namespace pm {
                 filter_t type,
                 double eps,
                 std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<double> const& opts);
+
+    template pmoutput_t<double> firpmspec<double>(
+                pmspec_t<double> const& spec);
+
+    template std::vector<pmoutput_t<double>> firpm_batch<double>(
+                std::vector<pmspec_t<double>> const& specs,
+                std::size_t nsplit);
+
+    template std::vector<pmoutput_t<double>> firpm_sweep<double>(
+                std::function<pmspec_t<double>(double const&)> const& spec,
+                std::vector<double> const& params,
+                std::size_t nchains);
+
+    template pmoutput_t<double> firpmord<double>(std::vector<double> const& f,
+                std::vector<double> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<double> const& opts);
 
     /* long double precision */
     template void uniform<long double>(std::vector<long double>& omega,
@@ -1577,7 +2570,8 @@ namespace pm {
                 std::vector<band_t<long double>>& chebyBands,
                 double eps,
                 std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
 
     template pmoutput_t<long double> firpm<long double>(std::size_t n,
                 std::vector<long double>const& f,
@@ -1588,7 +2582,8 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
 
     template pmoutput_t<long double> firpm<long double>(std::size_t n,
                 std::vector<long double>const& f,
@@ -1600,7 +2595,8 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
 
     template pmoutput_t<long double> firpmRS<long double>(std::size_t n,
                 std::vector<long double>const& f,
@@ -1609,7 +2605,8 @@ namespace pm {
                 double eps, std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
 
     template pmoutput_t<long double> firpmRS<long double>(std::size_t n,
                 std::vector<long double>const& f,
@@ -1620,14 +2617,16 @@ namespace pm {
                 std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
 
     template pmoutput_t<long double> firpmAFP<long double>(std::size_t n,
                 std::vector<long double>const& f,
                 std::vector<long double>const& a,
                 std::vector<long double>const& w,
                 double eps, std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
 
     template pmoutput_t<long double> firpmAFP<long double>(std::size_t n,
                 std::vector<long double>const& f,
@@ -1636,7 +2635,347 @@ namespace pm {
                 filter_t type,
                 double eps,
                 std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
+
+    template pmoutput_t<long double> firpmspec<long double>(
+                pmspec_t<long double> const& spec);
+
+    template std::vector<pmoutput_t<long double>> firpm_batch<long double>(
+                std::vector<pmspec_t<long double>> const& specs,
+                std::size_t nsplit);
+
+    template std::vector<pmoutput_t<long double>> firpm_sweep<long double>(
+                std::function<pmspec_t<long double>(long double const&)> const& spec,
+                std::vector<long double> const& params,
+                std::size_t nchains);
+
+    template pmoutput_t<long double> firpmord<long double>(std::vector<long double> const& f,
+                std::vector<long double> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<long double> const& opts);
+
+/* double-double precision */
+    template void uniform<ddouble>(std::vector<ddouble>& omega,
+                std::vector<band_t<ddouble>>& B, std::size_t n);
+
+    template void refscaling<ddouble>(status_t& status,
+                std::vector<ddouble>& newX,
+                std::vector<band_t<ddouble>>& newChebyBands,
+                std::vector<band_t<ddouble>>& newFreqBands,
+                std::size_t newXSize,
+                std::vector<ddouble>& x,
+                std::vector<band_t<ddouble>>& chebyBands,
+                std::vector<band_t<ddouble>>& freqBands);
+
+    template pmoutput_t<ddouble> exchange<ddouble>(std::vector<ddouble>& x,
+                std::vector<band_t<ddouble>>& chebyBands,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpm<ddouble>(std::size_t n,
+                std::vector<ddouble>const& f,
+                std::vector<ddouble>const& a,
+                std::vector<ddouble>const& w,
+                double eps,
+                std::size_t nmax,
+                init_t strategy,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpm<ddouble>(std::size_t n,
+                std::vector<ddouble>const& f,
+                std::vector<ddouble>const& a,
+                std::vector<ddouble>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                init_t strategy,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpmRS<ddouble>(std::size_t n,
+                std::vector<ddouble>const& f,
+                std::vector<ddouble>const& a,
+                std::vector<ddouble>const& w,
+                double eps, std::size_t nmax,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpmRS<ddouble>(std::size_t n,
+                std::vector<ddouble>const& f,
+                std::vector<ddouble>const& a,
+                std::vector<ddouble>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpmAFP<ddouble>(std::size_t n,
+                std::vector<ddouble>const& f,
+                std::vector<ddouble>const& a,
+                std::vector<ddouble>const& w,
+                double eps, std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpmAFP<ddouble>(std::size_t n,
+                std::vector<ddouble>const& f,
+                std::vector<ddouble>const& a,
+                std::vector<ddouble>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+    template pmoutput_t<ddouble> firpmspec<ddouble>(
+                pmspec_t<ddouble> const& spec);
+
+    template std::vector<pmoutput_t<ddouble>> firpm_batch<ddouble>(
+                std::vector<pmspec_t<ddouble>> const& specs,
+                std::size_t nsplit);
+
+    template std::vector<pmoutput_t<ddouble>> firpm_sweep<ddouble>(
+                std::function<pmspec_t<ddouble>(ddouble const&)> const& spec,
+                std::vector<ddouble> const& params,
+                std::size_t nchains);
+
+    template pmoutput_t<ddouble> firpmord<ddouble>(std::vector<ddouble> const& f,
+                std::vector<ddouble> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<ddouble> const& opts);
+
+#ifdef HAVE_QUADMATH
+    /* quadruple precision */
+    template void uniform<float128>(std::vector<float128>& omega,
+                std::vector<band_t<float128>>& B, std::size_t n);
+
+    template void refscaling<float128>(status_t& status,
+                std::vector<float128>& newX,
+                std::vector<band_t<float128>>& newChebyBands,
+                std::vector<band_t<float128>>& newFreqBands,
+                std::size_t newXSize,
+                std::vector<float128>& x,
+                std::vector<band_t<float128>>& chebyBands,
+                std::vector<band_t<float128>>& freqBands);
+
+    template pmoutput_t<float128> exchange<float128>(std::vector<float128>& x,
+                std::vector<band_t<float128>>& chebyBands,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpm<float128>(std::size_t n,
+                std::vector<float128>const& f,
+                std::vector<float128>const& a,
+                std::vector<float128>const& w,
+                double eps,
+                std::size_t nmax,
+                init_t strategy,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpm<float128>(std::size_t n,
+                std::vector<float128>const& f,
+                std::vector<float128>const& a,
+                std::vector<float128>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                init_t strategy,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpmRS<float128>(std::size_t n,
+                std::vector<float128>const& f,
+                std::vector<float128>const& a,
+                std::vector<float128>const& w,
+                double eps, std::size_t nmax,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpmRS<float128>(std::size_t n,
+                std::vector<float128>const& f,
+                std::vector<float128>const& a,
+                std::vector<float128>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpmAFP<float128>(std::size_t n,
+                std::vector<float128>const& f,
+                std::vector<float128>const& a,
+                std::vector<float128>const& w,
+                double eps, std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpmAFP<float128>(std::size_t n,
+                std::vector<float128>const& f,
+                std::vector<float128>const& a,
+                std::vector<float128>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+
+    template pmoutput_t<float128> firpmspec<float128>(
+                pmspec_t<float128> const& spec);
+
+    template std::vector<pmoutput_t<float128>> firpm_batch<float128>(
+                std::vector<pmspec_t<float128>> const& specs,
+                std::size_t nsplit);
+
+    template std::vector<pmoutput_t<float128>> firpm_sweep<float128>(
+                std::function<pmspec_t<float128>(float128 const&)> const& spec,
+                std::vector<float128> const& params,
+                std::size_t nchains);
+
+    template pmoutput_t<float128> firpmord<float128>(std::vector<float128> const& f,
+                std::vector<float128> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float128> const& opts);
+#endif
+
+#ifdef HAVE_BOOST_MP
+    /* octuple precision */
+    template void uniform<float256>(std::vector<float256>& omega,
+                std::vector<band_t<float256>>& B, std::size_t n);
+
+    template void refscaling<float256>(status_t& status,
+                std::vector<float256>& newX,
+                std::vector<band_t<float256>>& newChebyBands,
+                std::vector<band_t<float256>>& newFreqBands,
+                std::size_t newXSize,
+                std::vector<float256>& x,
+                std::vector<band_t<float256>>& chebyBands,
+                std::vector<band_t<float256>>& freqBands);
+
+    template pmoutput_t<float256> exchange<float256>(std::vector<float256>& x,
+                std::vector<band_t<float256>>& chebyBands,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpm<float256>(std::size_t n,
+                std::vector<float256>const& f,
+                std::vector<float256>const& a,
+                std::vector<float256>const& w,
+                double eps,
+                std::size_t nmax,
+                init_t strategy,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpm<float256>(std::size_t n,
+                std::vector<float256>const& f,
+                std::vector<float256>const& a,
+                std::vector<float256>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                init_t strategy,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpmRS<float256>(std::size_t n,
+                std::vector<float256>const& f,
+                std::vector<float256>const& a,
+                std::vector<float256>const& w,
+                double eps, std::size_t nmax,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpmRS<float256>(std::size_t n,
+                std::vector<float256>const& f,
+                std::vector<float256>const& a,
+                std::vector<float256>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                std::size_t depth,
+                init_t rstrategy,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpmAFP<float256>(std::size_t n,
+                std::vector<float256>const& f,
+                std::vector<float256>const& a,
+                std::vector<float256>const& w,
+                double eps, std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpmAFP<float256>(std::size_t n,
+                std::vector<float256>const& f,
+                std::vector<float256>const& a,
+                std::vector<float256>const& w,
+                filter_t type,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+
+    template pmoutput_t<float256> firpmspec<float256>(
+                pmspec_t<float256> const& spec);
+
+    template std::vector<pmoutput_t<float256>> firpm_batch<float256>(
+                std::vector<pmspec_t<float256>> const& specs,
+                std::size_t nsplit);
+
+    template std::vector<pmoutput_t<float256>> firpm_sweep<float256>(
+                std::function<pmspec_t<float256>(float256 const&)> const& spec,
+                std::vector<float256> const& params,
+                std::size_t nchains);
+
+    template pmoutput_t<float256> firpmord<float256>(std::vector<float256> const& f,
+                std::vector<float256> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<float256> const& opts);
+#endif
 
 /* multiple precision mpreal */
 #ifdef HAVE_MPFR
@@ -1655,7 +2994,8 @@ namespace pm {
     template pmoutput_t<mpfr::mpreal> exchange<mpfr::mpreal>(std::vector<mpfr::mpreal>& x,
                 std::vector<band_t<mpfr::mpreal>>& chebyBands,
                 double eps,
-                std::size_t nmax, unsigned long prec);
+                std::size_t nmax, unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 
     template pmoutput_t<mpfr::mpreal> firpm<mpfr::mpreal>(std::size_t n,
                 std::vector<mpfr::mpreal>const& f,
@@ -1666,7 +3006,8 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 
     template pmoutput_t<mpfr::mpreal> firpm<mpfr::mpreal>(std::size_t n,
                 std::vector<mpfr::mpreal>const& f,
@@ -1678,7 +3019,8 @@ namespace pm {
                 init_t strategy,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 
     template pmoutput_t<mpfr::mpreal> firpmRS<mpfr::mpreal>(std::size_t n,
                 std::vector<mpfr::mpreal>const& f,
@@ -1687,7 +3029,8 @@ namespace pm {
                 double eps, std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 
     template pmoutput_t<mpfr::mpreal> firpmRS<mpfr::mpreal>(std::size_t n,
                 std::vector<mpfr::mpreal>const& f,
@@ -1698,14 +3041,16 @@ namespace pm {
                 std::size_t nmax,
                 std::size_t depth,
                 init_t rstrategy,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 
     template pmoutput_t<mpfr::mpreal> firpmAFP<mpfr::mpreal>(std::size_t n,
                 std::vector<mpfr::mpreal>const& f,
                 std::vector<mpfr::mpreal>const& a,
                 std::vector<mpfr::mpreal>const& w,
                 double eps, std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 
     template pmoutput_t<mpfr::mpreal> firpmAFP<mpfr::mpreal>(std::size_t n,
                 std::vector<mpfr::mpreal>const& f,
@@ -1714,7 +3059,28 @@ namespace pm {
                 filter_t type,
                 double eps,
                 std::size_t nmax,
-                unsigned long prec);
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
+
+    template pmoutput_t<mpfr::mpreal> firpmspec<mpfr::mpreal>(
+                pmspec_t<mpfr::mpreal> const& spec);
+
+    template std::vector<pmoutput_t<mpfr::mpreal>> firpm_batch<mpfr::mpreal>(
+                std::vector<pmspec_t<mpfr::mpreal>> const& specs,
+                std::size_t nsplit);
+
+    template std::vector<pmoutput_t<mpfr::mpreal>> firpm_sweep<mpfr::mpreal>(
+                std::function<pmspec_t<mpfr::mpreal>(mpfr::mpreal const&)> const& spec,
+                std::vector<mpfr::mpreal> const& params,
+                std::size_t nchains);
+
+    template pmoutput_t<mpfr::mpreal> firpmord<mpfr::mpreal>(std::vector<mpfr::mpreal> const& f,
+                std::vector<mpfr::mpreal> const& a,
+                std::vector<double> const& dev,
+                double eps,
+                std::size_t nmax,
+                unsigned long prec,
+                pmopts_t<mpfr::mpreal> const& opts);
 #endif
 
 } // namespace pm
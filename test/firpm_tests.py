@@ -52,3 +52,25 @@ def test_lpf_spectrum(request, n, fpass, fstop, ripple, attenuation):
 
     # Raise deferred exception if we failed
     assert success
+
+
+def test_warm_start_chain():
+    # Design a lowpass filter, then move its stopband edge slightly and
+    # redesign starting from the reference of the first design
+    f = [0.0, 0.4, 0.5, 1.0]
+    a = [1.0, 1.0, 0.0, 0.0]
+    w = [1.0, 10.0]
+    h, x = pyfirpm.firpm(101, f, a, w, return_x=True)
+    assert len(h) == 102
+    assert len(x) > 0
+    assert np.all(np.diff(x) > 0)
+    assert x[0] >= 0.0 and x[-1] <= 1.0
+
+    f[2] = 0.505
+    hw, xw = pyfirpm.firpm(101, f, a, w, x0=x, return_x=True)
+    hc = pyfirpm.firpm(101, f, a, w)
+    assert len(xw) == len(x)
+    assert np.max(np.abs(np.array(hw) - np.array(hc))) < 1e-8
+
+    # Without return_x only the taps come back
+    assert np.allclose(pyfirpm.firpm(101, f, a, w, x0=x), hw)
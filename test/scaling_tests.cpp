@@ -1,7 +1,16 @@
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <fstream>
+#include <limits>
 #include <chrono>
 #include <type_traits>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <dirent.h>
+#include <unistd.h>
+#include <omp.h>
 #include "firpm.h"
 #include "gtest/gtest.h"
 
@@ -12,11 +21,21 @@ using pm::firpmAFP;
 using pm::pmoutput_t;
 using pm::filter_t;
 
+#if defined(HAVE_QUADMATH)
+    #define FIXEDPREC_TYPES , pm::float128, pm::float256
+#elif defined(HAVE_BOOST_MP)
+    #define FIXEDPREC_TYPES , pm::float256
+#else
+    #define FIXEDPREC_TYPES
+#endif
+
 #ifdef HAVE_MPFR
     #include <unsupported/Eigen/MPRealSupport>
-    using types = testing::Types<double, long double, mpfr::mpreal>;
+    using types = testing::Types<double, long double, pm::ddouble
+        FIXEDPREC_TYPES, mpfr::mpreal>;
 #else
-    using types = testing::Types<double, long double>;
+    using types = testing::Types<double, long double, pm::ddouble
+        FIXEDPREC_TYPES>;
 #endif
 
 template<typename _T>
@@ -35,6 +54,30 @@ template<typename _T>
 struct firpm_issues_test : public testing::Test { using T = _T; };
 TYPED_TEST_SUITE(firpm_issues_test, types);
 
+template<typename _T>
+struct firpm_batch_test : public testing::Test { using T = _T; };
+TYPED_TEST_SUITE(firpm_batch_test, types);
+
+template<typename _T>
+struct firpm_sweep_test : public testing::Test { using T = _T; };
+TYPED_TEST_SUITE(firpm_sweep_test, types);
+
+template<typename _T>
+struct firpm_order_test : public testing::Test { using T = _T; };
+TYPED_TEST_SUITE(firpm_order_test, types);
+
+template<typename _T>
+struct firpm_cache_test : public testing::Test { using T = _T; };
+TYPED_TEST_SUITE(firpm_cache_test, types);
+
+template<typename _T>
+struct firpm_bary_test : public testing::Test { using T = _T; };
+TYPED_TEST_SUITE(firpm_bary_test, types);
+
+template<typename _T>
+struct firpm_regression_test : public testing::Test { using T = _T; };
+TYPED_TEST_SUITE(firpm_regression_test, types);
+
 // example of how to use the exchange method directly
 TYPED_TEST(firpm_scaling_test, lowpass50a)
 {
@@ -90,6 +133,182 @@ TYPED_TEST(firpm_scaling_test, lowpass50a)
 
 }
 
+// the batch evaluation of the barycentric formulas gives the same values as
+// the pointwise one, including at the reference points
+TYPED_TEST(firpm_bary_test, batch)
+{
+#ifdef HAVE_MPFR
+    mpfr::mpreal::set_default_prec(165ul);
+#endif
+
+    using T = typename TestFixture::T;
+
+    std::vector<pm::band_t<T>> freqBands(2);
+    freqBands[0].start = 0;
+    freqBands[0].stop = pm::pmmath::const_pi<T>() * 0.4;
+    freqBands[0].weight = [] (pm::space_t, T) -> T {return 1; };
+    freqBands[0].space = pm::space_t::FREQ;
+    freqBands[0].amplitude = [](pm::space_t, T) -> T { return 1; };
+    freqBands[1].start = pm::pmmath::const_pi<T>() * 0.5;
+    freqBands[1].stop = pm::pmmath::const_pi<T>();
+    freqBands[1].weight = [] (pm::space_t, T) -> T {return 10; };
+    freqBands[1].space = pm::space_t::FREQ;
+    freqBands[1].amplitude = [](pm::space_t, T) -> T { return 0; };
+
+    std::size_t degree = 100u;
+    std::vector<pm::band_t<T>> chebyBands;
+    std::vector<T> omega(degree + 2u);
+    std::vector<T> x(degree + 2u);
+    pm::uniform(omega, freqBands, degree + 2u);
+    pm::cos(x, omega);
+    std::sort(x.begin(), x.end());
+    pm::bandconv(chebyBands, freqBands, pm::convdir_t::FROMFREQ);
+
+    T delta;
+    std::vector<T> w(x.size()), C(x.size());
+    pm::baryweights(w, x);
+    pm::compdelta(delta, w, x, chebyBands);
+    pm::compc(C, delta, x, chebyBands);
+
+    // an odd number of points, so that the last block is incomplete, with
+    // some of the reference points among them
+    std::vector<T> xVal(1001u);
+    for(std::size_t i{0u}; i < xVal.size(); ++i)
+        xVal[i] = pm::pmmath::cos(pm::pmmath::const_pi<T>() * T(i) / T(xVal.size() - 1u));
+    for(std::size_t i{0u}; i < x.size(); i += 10u)
+        xVal[3u * i + 1u] = x[i];
+
+    std::vector<T> Pc, error;
+    pm::approx(Pc, xVal, x, C, w);
+    pm::comperror(error, xVal, delta, x, C, w, chebyBands);
+    ASSERT_EQ(Pc.size(), xVal.size());
+    ASSERT_EQ(error.size(), xVal.size());
+    for(std::size_t i{0u}; i < xVal.size(); ++i) {
+        T p, e;
+        pm::approx(p, xVal[i], x, C, w);
+        pm::comperror(e, xVal[i], delta, x, C, w, chebyBands);
+        ASSERT_EQ(Pc[i], p);
+        ASSERT_EQ(error[i], e);
+    }
+}
+
+// the FFT used by chebcoeffs above CHEBCOEFFS_FFT_THRESHOLD points gives the
+// coefficients of the direct O(n^2) sums it replaced
+TYPED_TEST(firpm_regression_test, chebcoeffs)
+{
+#ifdef HAVE_MPFR
+    mpfr::mpreal::set_default_prec(165ul);
+#endif
+
+    using T = typename TestFixture::T;
+    // the angles of the FFT are multiples of const_pi, which for long double
+    // is only accurate to double precision
+    T eps = std::numeric_limits<T>::epsilon() +
+        pm::pmmath::fabs(pm::pmmath::sin(pm::pmmath::const_pi<T>()));
+    for(std::size_t n : {100u, 129u, 257u, 300u}) {
+        std::size_t N = n - 1u;
+        std::vector<T> fv(n), c(n), cs(2u * N);
+        for(std::size_t j{0u}; j < n; ++j)
+            fv[j] = pm::pmmath::cos(T(j)) + T(j % 3u);
+        for(std::size_t m{0u}; m < 2u * N; ++m)
+            cs[m] = pm::pmmath::cos(pm::pmmath::const_pi<T>() * T(m) / T(N));
+        pm::chebcoeffs(c, fv);
+        for(std::size_t i{0u}; i < n; ++i) {
+            T ref = (fv[0] + fv[N] * cs[(i * N) % (2u * N)]) / 2;
+            for(std::size_t j{1u}; j < N; ++j)
+                ref += fv[j] * cs[(i * j) % (2u * N)];
+            ref *= 2;
+            ref /= N;
+            if(i == 0u || i == N)
+                ref /= 2;
+            ASSERT_LE(pm::pmmath::fabs(c[i] - ref), eps * T(30u * n)) << n << ' ' << i;
+        }
+    }
+}
+
+// the barycentric weights of large references, accumulated as mantissas and
+// exponents, agree with the log-sum formula they replaced and with the
+// direct products
+TYPED_TEST(firpm_regression_test, baryweights)
+{
+#ifdef HAVE_MPFR
+    mpfr::mpreal::set_default_prec(165ul);
+#endif
+
+    using T = typename TestFixture::T;
+    T eps = std::numeric_limits<T>::epsilon();
+    std::size_t n = 613u;
+    std::vector<T> x(n), w(n);
+    for(std::size_t i{0u}; i < n; ++i)
+        x[i] = pm::pmmath::cos(pm::pmmath::const_pi<T>() *
+                (T(i) + pm::pmmath::sin(T(i)) / 4) / T(n - 1u));
+    pm::baryweights(w, x);
+    for(std::size_t i{0u}; i < n; ++i) {
+        T prod = 1, lsum = 0, sign = 1;
+        for(std::size_t j{0u}; j < n; ++j) {
+            if(j == i)
+                continue;
+            prod *= (x[i] - x[j]) * 2;
+            lsum += pm::pmmath::log(pm::pmmath::fabs(x[i] - x[j]));
+            if(x[i] < x[j])
+                sign = -sign;
+        }
+        T direct = T(1) / prod;
+        T logsum = sign / pm::pmmath::exp(lsum + pm::pmmath::log(T(2)) * T(n - 1u));
+        ASSERT_LE(pm::pmmath::fabs((w[i] - direct) / direct), eps * T(4u * n)) << i;
+        ASSERT_LE(pm::pmmath::fabs((w[i] - logsum) / logsum), eps * T(10000u * n)) << i;
+    }
+}
+
+// designs that reuse the per-thread scratch of earlier, larger designs give
+// the same results as when they run first
+TYPED_TEST(firpm_regression_test, workspace)
+{
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.4, 0.5, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 10.0};
+
+    auto output1 = firpm<T>(100u, f, a, w);
+    firpm<T>(301u, f, a, w);
+    auto output2 = firpm<T>(100u, f, a, w);
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_EQ(output2.iter, output1.iter);
+    ASSERT_EQ(output2.delta, output1.delta);
+    ASSERT_EQ(output2.x, output1.x);
+    ASSERT_EQ(output2.h, output1.h);
+}
+
+// results of the library before the iterations reused their workspace and
+// before the FFT coefficients and the new barycentric weights (the designs
+// converge in as many iterations, to the same filters up to rounding)
+TEST(firpm_regression_double_test, baseline)
+{
+    std::vector<double> f = {0.0, 0.4, 0.5, 1.0};
+    std::vector<double> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<double> w = {1.0, 10.0};
+    struct baseline_t {
+        std::size_t n;
+        pm::init_t strategy;
+        std::size_t iter;
+        double delta, h0;
+    };
+    std::vector<baseline_t> baselines = {
+        {100u, pm::init_t::UNIFORM, 7u, 0.00017705690881057623, -1.8538825022049177e-05},
+        {100u, pm::init_t::SCALING, 5u, 0.00017706204735500806, -1.8537250503165014e-05},
+        {101u, pm::init_t::UNIFORM, 7u, 0.00017090079173166255, 2.5048858822823705e-06},
+        {101u, pm::init_t::SCALING, 4u, 0.00017091178141345, 2.505094599435931e-06},
+    };
+    for(auto const& it : baselines) {
+        auto output = firpm<double>(it.n, f, a, w, 0.01, 4u, it.strategy,
+                it.strategy == pm::init_t::SCALING ? 1u : 0u);
+        ASSERT_EQ(output.status, pm::status_t::STATUS_SUCCESS);
+        ASSERT_EQ(output.iter, it.iter);
+        ASSERT_NEAR(output.delta, it.delta, 1e-10 * it.delta);
+        ASSERT_NEAR(output.h[0], it.h0, 1e-12);
+    }
+}
+
 // Filters appearing inside Section 1 & Section 4 (minus the degree 53348 one)
 TYPED_TEST(firpm_scaling_test, lowpass50)
 {
@@ -975,4 +1194,685 @@ TYPED_TEST(firpm_issues_test, partition2) {
 
     std::cout << "Iteration count reduction for final filter  RS: " << 1.0 - (double)output2.iter / output1.iter << std::endl;
     std::cout << "Iteration count reduction for final filter AFP: " << 1.0 - (double)output3.iter / output1.iter << std::endl;
-}
\ No newline at end of file
+}
+
+TYPED_TEST(firpm_issues_test, adaptivenmax) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.4, 0.41, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 1.0};
+    std::size_t degree = 150u;
+
+    std::cout << "START Parks-McClellan with adaptive CPR degree\n";
+    auto output1 = firpm<T>(degree * 2u, f, a, w, 0.01, pm::NMAX_ADAPTIVE);
+    std::cout << "Final Delta     = " << output1.delta << std::endl;
+    std::cout << "Iteration count = " << output1.iter  << std::endl;
+    std::cout << "FINISH Parks-McClellan with adaptive CPR degree\n";
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_LT(output1.q, 1e-2);
+
+    auto output2 = firpm<T>(degree * 2u, f, a, w, 0.01, 8u);
+    ASSERT_LT(output2.q, 1e-2);
+    ASSERT_LE(pm::pmmath::fabs((output1.delta-output2.delta)/output2.delta), 1e-2);
+}
+
+TYPED_TEST(firpm_issues_test, fmmeval) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.3, 0.31, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 10.0};
+    std::size_t degree = 300u;
+
+    pm::pmopts_t<T> direct, fmm;
+    direct.bary = pm::bary_t::DIRECT;
+    fmm.bary = pm::bary_t::FMM;
+    std::cout << "START Parks-McClellan with FMM barycentric evaluation\n";
+    auto output1 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, fmm);
+    std::cout << "Final Delta     = " << output1.delta << std::endl;
+    std::cout << "Iteration count = " << output1.iter  << std::endl;
+    std::cout << "FINISH Parks-McClellan with FMM barycentric evaluation\n";
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_LT(output1.q, 1e-2);
+
+    auto output2 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, direct);
+    ASSERT_LE(pm::pmmath::fabs((output1.delta-output2.delta)/output2.delta), 1e-6);
+    for(std::size_t i{0u}; i < output1.h.size(); ++i)
+        ASSERT_LE(pm::pmmath::fabs(output1.h[i]-output2.h[i]), 1e-8);
+}
+
+TYPED_TEST(firpm_issues_test, ladder) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.2, 0.22, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 10.0};
+    std::size_t degree = 250u;
+
+    pm::pmopts_t<T> opts;
+    opts.ladder = true;
+    std::cout << "START Parks-McClellan with precision ladder\n";
+    auto output1 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    std::cout << "Final Delta     = " << output1.delta << std::endl;
+    std::cout << "Iteration count = " << output1.iter  << std::endl;
+    std::cout << "FINISH Parks-McClellan with precision ladder\n";
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_LT(output1.q, 1e-2);
+
+    auto output2 = firpm<T>(degree * 2u, f, a, w);
+    ASSERT_LE(pm::pmmath::fabs((output1.delta-output2.delta)/output2.delta), 1e-2);
+}
+
+TYPED_TEST(firpm_issues_test, observer) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.2, 0.22, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 10.0};
+    std::size_t degree = 100u;
+
+    std::vector<pm::pmprogress_t> trace;
+    pm::pmopts_t<T> opts;
+    opts.observer = [&trace](pm::pmprogress_t const& p) {
+        trace.push_back(p);
+        return true;
+    };
+    auto output1 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_EQ(trace.size(), output1.iter);
+    for(std::size_t i{0u}; i < trace.size(); ++i) {
+        ASSERT_EQ(trace[i].iter, i + 1u);
+        ASSERT_EQ(trace[i].refsize, degree + 2u);
+        ASSERT_EQ(trace[i].bandcount.size(), 2u);
+        ASSERT_EQ(trace[i].bandcount[0] + trace[i].bandcount[1], degree + 2u);
+        if(i > 0u) {
+            ASSERT_GE(trace[i].elapsed, trace[i - 1u].elapsed);
+        }
+    }
+    ASSERT_EQ(trace.back().q, pm::pmmath::convert<double>(output1.q));
+
+    // stop after the first iteration
+    std::size_t calls{0u};
+    opts.observer = [&calls](pm::pmprogress_t const&) {
+        ++calls;
+        return false;
+    };
+    auto output2 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    ASSERT_EQ(calls, 1u);
+    ASSERT_EQ(output2.iter, 1u);
+    ASSERT_EQ(output2.status, pm::status_t::STATUS_CONVERGENCE_WARNING);
+    ASSERT_EQ(output2.h.size(), degree * 2u + 1u);
+}
+
+TYPED_TEST(firpm_issues_test, interrupted) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.2, 0.22, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 10.0};
+    std::size_t degree = 100u;
+
+    // cancelled from the third iteration on
+    std::atomic<bool> cancel{false};
+    double qmin{1.0};
+    pm::pmopts_t<T> opts;
+    opts.cancel = &cancel;
+    opts.observer = [&](pm::pmprogress_t const& p) {
+        qmin = std::min(qmin, p.q);
+        if(p.iter == 3u)
+            cancel = true;
+        return true;
+    };
+    auto output1 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_INTERRUPTED);
+    ASSERT_EQ(output1.iter, 3u);
+    ASSERT_EQ(pm::pmmath::convert<double>(output1.q), qmin);
+    ASSERT_EQ(output1.h.size(), degree * 2u + 1u);
+    for(auto& it : output1.h)
+        ASSERT_TRUE(pm::pmmath::isfinite(it));
+
+    // past deadline, the filter of the starting reference is returned
+    pm::pmopts_t<T> opts2;
+    opts2.deadline = std::chrono::steady_clock::now();
+    auto output2 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts2);
+    ASSERT_EQ(output2.status, pm::status_t::STATUS_INTERRUPTED);
+    ASSERT_EQ(output2.iter, 0u);
+    ASSERT_EQ(output2.h.size(), degree * 2u + 1u);
+    ASSERT_LT(output2.delta, output1.delta);
+}
+
+TYPED_TEST(firpm_issues_test, warmstart) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.2, 0.22, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<T> w = {1.0, 10.0};
+    std::size_t degree = 100u;
+
+    auto output1 = firpm<T>(degree * 2u, f, a, w);
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+
+    // slightly wider transition band, same number of coefficients
+    f[2] = 0.225;
+    pm::pmopts_t<T> opts;
+    opts.x0 = output1.x;
+    auto output2 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    auto output3 = firpm<T>(degree * 2u, f, a, w);
+    ASSERT_EQ(output2.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_LT(output2.iter, output3.iter);
+    ASSERT_LE(pm::pmmath::fabs((output2.delta-output3.delta)/output3.delta), 1e-2);
+
+    // more coefficients, starting reference given in frequency
+    opts.x0space = pm::space_t::FREQ;
+    for(auto& it : opts.x0)
+        it = pm::pmmath::acos(it);
+    auto output4 = firpm<T>(degree * 2u + 20u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    auto output5 = firpm<T>(degree * 2u + 20u, f, a, w);
+    ASSERT_EQ(output4.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_EQ(output4.x.size(), degree + 12u);
+    ASSERT_LE(pm::pmmath::fabs((output4.delta-output5.delta)/output5.delta), 1e-2);
+
+    opts.x0[0] = -1.0;
+    auto output6 = firpm<T>(degree * 2u, f, a, w, 0.01, 4u, pm::init_t::UNIFORM,
+            0u, pm::init_t::UNIFORM, 165ul, opts);
+    ASSERT_EQ(output6.status, pm::status_t::STATUS_FREQUENCY_INVALID_INTERVAL);
+}
+
+TYPED_TEST(firpm_batch_test, mixed) {
+
+    using T = typename TestFixture::T;
+    std::vector<pm::pmspec_t<T>> specs(6);
+    for(std::size_t i{0u}; i < specs.size(); ++i) {
+        specs[i].n = 40u + 20u * i;
+        specs[i].f = {0.0, 0.4, 0.5, 1.0};
+        specs[i].a = {1.0, 1.0, 0.0, 0.0};
+        specs[i].w = {1.0, 10.0};
+    }
+    specs[2].strategy = pm::init_t::AFP;
+    specs[3].antisym = true;
+    specs[3].type = filter_t::FIR_HILBERT;
+    specs[3].f = {0.1, 0.9};
+    specs[3].a = {1.0, 1.0};
+    specs[3].w = {1.0};
+    specs[1].n = 61u;
+    specs[4].n = 301u;
+    specs[4].f = {0.0, 0.4, 0.41, 1.0};
+
+    // the designs share an observer, which is not called concurrently
+    bool busy{false}, overlap{false};
+    std::size_t calls{0u};
+    for(auto& it : specs)
+        it.opts.observer = [&](pm::pmprogress_t const&) {
+            overlap = overlap || busy;
+            busy = true;
+            ++calls;
+            std::this_thread::yield();
+            busy = false;
+            return true;
+        };
+
+    // the last design goes through the within-design parallel path
+    auto start = std::chrono::steady_clock::now();
+    auto outputs = pm::firpm_batch(specs, 300u);
+    auto stop  = std::chrono::steady_clock::now();
+    double elapsedTime = std::chrono::duration_cast<
+        std::chrono::duration<double>>(stop - start).count();
+    std::cout << "Elapsed time = " << elapsedTime << std::endl;
+
+    ASSERT_EQ(outputs.size(), specs.size());
+    for(std::size_t i{0u}; i < specs.size(); ++i) {
+        pmoutput_t<T> ref = specs[i].antisym
+            ? firpm<T>(specs[i].n, specs[i].f, specs[i].a, specs[i].w,
+                    specs[i].type, specs[i].eps, specs[i].nmax, specs[i].strategy)
+            : firpm<T>(specs[i].n, specs[i].f, specs[i].a, specs[i].w,
+                    specs[i].eps, specs[i].nmax, specs[i].strategy);
+        std::cout << "Final Delta     = " << outputs[i].delta << std::endl;
+        ASSERT_LT(outputs[i].q, 1e-2);
+        ASSERT_EQ(outputs[i].h.size(), ref.h.size());
+        ASSERT_EQ(outputs[i].iter, ref.iter);
+        ASSERT_LE(pm::pmmath::fabs((outputs[i].delta-ref.delta)/ref.delta), 1e-8);
+    }
+    ASSERT_FALSE(overlap);
+    ASSERT_GE(calls, specs.size());
+}
+
+TYPED_TEST(firpm_batch_test, nested) {
+
+    using T = typename TestFixture::T;
+    std::vector<pm::pmspec_t<T>> specs(4);
+    for(std::size_t i{0u}; i < specs.size(); ++i) {
+        specs[i].n = 80u + 10u * i;
+        specs[i].f = {0.0, 0.4, 0.5, 1.0};
+        specs[i].a = {1.0, 1.0, 0.0, 0.0};
+        specs[i].w = {1.0, 10.0};
+    }
+
+    // with nested parallelism enabled, the designs run across the threads
+    // still do their iterations on a single thread each
+    int levels = omp_get_max_active_levels();
+    int nthreads = omp_get_max_threads();
+    omp_set_max_active_levels(2);
+    omp_set_num_threads(2);
+    auto outputs = pm::firpm_batch(specs);
+    omp_set_max_active_levels(levels);
+    omp_set_num_threads(nthreads);
+    for(std::size_t i{0u}; i < specs.size(); ++i) {
+        auto ref = pm::firpmspec(specs[i]);
+        ASSERT_EQ(outputs[i].status, pm::status_t::STATUS_SUCCESS);
+        ASSERT_EQ(outputs[i].iter, ref.iter);
+        ASSERT_EQ(outputs[i].h, ref.h);
+    }
+}
+
+TYPED_TEST(firpm_sweep_test, stopbandedge) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> edges;
+    for(std::size_t i{0u}; i < 6u; ++i)
+        edges.push_back(T(0.22) + T(0.001) * i);
+    auto spec = [](T const& fs) {
+        pm::pmspec_t<T> spec;
+        spec.n = 200u;
+        spec.f = {0.0, 0.2, fs, 1.0};
+        spec.a = {1.0, 1.0, 0.0, 0.0};
+        spec.w = {1.0, 10.0};
+        return spec;
+    };
+
+    auto outputs = pm::firpm_sweep<T>(spec, edges);
+    auto outputs2 = pm::firpm_sweep<T>(spec, edges, 3u);
+    ASSERT_EQ(outputs.size(), edges.size());
+    std::size_t iter{0u}, coldIter{0u};
+    for(std::size_t i{0u}; i < edges.size(); ++i) {
+        auto ref = pm::firpmspec(spec(edges[i]));
+        ASSERT_EQ(outputs[i].status, pm::status_t::STATUS_SUCCESS);
+        ASSERT_EQ(outputs2[i].status, pm::status_t::STATUS_SUCCESS);
+        ASSERT_LE(pm::pmmath::fabs((outputs[i].delta-ref.delta)/ref.delta), 1e-2);
+        ASSERT_LE(pm::pmmath::fabs((outputs2[i].delta-ref.delta)/ref.delta), 1e-2);
+        iter += outputs[i].iter;
+        coldIter += ref.iter;
+    }
+    std::cout << "Iterations (sweep/cold) = " << iter << "/" << coldIter << std::endl;
+    ASSERT_LT(iter, coldIter);
+}
+
+TYPED_TEST(firpm_order_test, minorder) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.4, 0.45, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<double> dev = {pm::ripple2dev(0.1), pm::atten2dev(60.0)};
+
+    auto output = pm::firpmord<T>(f, a, dev);
+    ASSERT_EQ(output.status, pm::status_t::STATUS_SUCCESS);
+    std::size_t n = output.h.size() - 1u;
+    std::cout << "Minimum order = " << n << std::endl;
+    ASSERT_LE(output.delta, dev[0]);
+
+    // one order less does not meet the specification
+    std::vector<T> w = {1.0, dev[0] / dev[1]};
+    auto lower = firpm<T>(n - 1u, f, a, w);
+    ASSERT_EQ(lower.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_GT(lower.delta, dev[0]);
+}
+
+TYPED_TEST(firpm_order_test, onethread) {
+
+    using T = typename TestFixture::T;
+    std::vector<T> f = {0.0, 0.4, 0.45, 1.0};
+    std::vector<T> a = {1.0, 1.0, 0.0, 0.0};
+    std::vector<double> dev = {pm::ripple2dev(0.1), pm::atten2dev(80.0)};
+
+    // the runs of the exchange algorithm are counted by their first iteration
+    std::size_t designs{0u};
+    pm::pmopts_t<T> opts;
+    opts.observer = [&designs](pm::pmprogress_t const& p) {
+        if(p.iter == 1u && !p.rung)
+            ++designs;
+        return true;
+    };
+
+    // with a single thread, the bracket is bisected
+    int nthreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    auto output = pm::firpmord<T>(f, a, dev, 0.01, 4u, 165ul, opts);
+    omp_set_num_threads(nthreads);
+    ASSERT_EQ(output.status, pm::status_t::STATUS_SUCCESS);
+    std::cout << "Minimum order = " << output.h.size() - 1u
+        << ", designs = " << designs << std::endl;
+    ASSERT_LE(output.delta, dev[0]);
+    ASSERT_LE(designs, 16u);
+}
+
+TEST(firpm_order_double_test, errors) {
+
+    std::vector<double> f = {0.0, 0.1, 0.9, 1.0};
+    std::vector<double> a = {1.0, 1.0, 0.0, 0.0};
+
+    auto output = pm::firpmord<double>(f, a, {0.01});
+    ASSERT_EQ(output.status, pm::status_t::STATUS_WEIGHT_VECTOR_MISMATCH);
+    ASSERT_EQ(output.iter, 0u);
+    ASSERT_TRUE(output.h.empty());
+    output = pm::firpmord<double>(f, a, {0.01, -0.01});
+    ASSERT_EQ(output.status, pm::status_t::STATUS_WEIGHT_NEGATIVE);
+    ASSERT_EQ(output.iter, 0u);
+
+    // errors of the specification itself are not retried at other orders
+    output = pm::firpmord<double>({0.0, 0.5, 0.4, 1.0}, a, {0.01, 0.01});
+    ASSERT_EQ(output.status, pm::status_t::STATUS_FREQUENCY_INVALID_INTERVAL);
+
+    // deviations far below the accuracy of double precision
+    output = pm::firpmord<double>(f, a, {1e-30, 1e-30});
+    ASSERT_EQ(output.status, pm::status_t::STATUS_ORDER_LIMIT);
+    ASSERT_GT(output.delta, 1e-30);
+}
+
+// temporary directory, removed with its files at the end of a test
+struct tmpdir_t {
+    std::string path;
+
+    ~tmpdir_t() {
+        if(DIR* d = opendir(path.c_str())) {
+            while(dirent* e = readdir(d)) {
+                std::string name{e->d_name};
+                if(name != "." && name != "..")
+                    std::remove((path + '/' + name).c_str());
+            }
+            closedir(d);
+        }
+        rmdir(path.c_str());
+    }
+};
+
+TYPED_TEST(firpm_cache_test, disk) {
+
+    using T = typename TestFixture::T;
+    std::string dir = testing::TempDir() + "firpm_cache_XXXXXX";
+    ASSERT_NE(mkdtemp(&dir[0]), nullptr);
+    tmpdir_t guard{dir};
+    pm::diskcache_t<T> cache(dir);
+
+    pm::pmspec_t<T> spec;
+    spec.n = 200u;
+    spec.f = {0.0, 0.2, 0.22, 1.0};
+    spec.a = {1.0, 1.0, 0.0, 0.0};
+    spec.w = {1.0, 10.0};
+
+    pmoutput_t<T> output;
+    ASSERT_FALSE(cache.lookup(spec, output));
+    auto output1 = cache.firpm(spec);
+    ASSERT_EQ(output1.status, pm::status_t::STATUS_SUCCESS);
+
+    // a hit gives back the design as it was computed
+    ASSERT_TRUE(cache.lookup(spec, output));
+    ASSERT_EQ(output.iter, output1.iter);
+    ASSERT_EQ(output.delta, output1.delta);
+    ASSERT_EQ(output.x, output1.x);
+    ASSERT_EQ(output.h, output1.h);
+
+    // a near miss starts from the reference of the previous design, which
+    // it replaces for the family without being saved under its own key
+    spec.f[2] = 0.225;
+    auto output2 = cache.firpm(spec);
+    auto output3 = pm::firpmspec(spec);
+    ASSERT_EQ(output2.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_LT(output2.iter, output3.iter);
+    ASSERT_LE(pm::pmmath::fabs((output2.delta-output3.delta)/output3.delta), 1e-2);
+    ASSERT_FALSE(cache.lookup(spec, output));
+    std::vector<T> x;
+    ASSERT_TRUE(cache.nearest(spec, x));
+    ASSERT_EQ(x, output2.x);
+
+    // the evaluation of the barycentric formulas is part of the key
+    spec.f[2] = 0.22;
+    spec.opts.bary = pm::bary_t::AUTO;
+    ASSERT_FALSE(cache.lookup(spec, output));
+
+    // designs with their own starting reference are not cached
+    spec.opts.bary = pm::bary_t::DIRECT;
+    spec.opts.x0 = output2.x;
+    ASSERT_FALSE(cache.lookup(spec, output));
+    auto output4 = cache.firpm(spec);
+    ASSERT_EQ(output4.status, pm::status_t::STATUS_SUCCESS);
+    spec.opts.x0.clear();
+    ASSERT_TRUE(cache.lookup(spec, output));
+    ASSERT_EQ(output.h, output1.h);
+}
+
+TYPED_TEST(firpm_cache_test, memory) {
+
+    using T = typename TestFixture::T;
+    pm::pmspec_t<T> spec;
+    spec.n = 200u;
+    spec.f = {0.0, 0.2, 0.22, 1.0};
+    spec.a = {1.0, 1.0, 0.0, 0.0};
+    spec.w = {1.0, 10.0};
+
+    // identical requests from several threads are designed once
+    pm::memcache_t<T> cache(1u << 20, 4u);
+    std::vector<pmoutput_t<T>> outputs(4);
+    std::vector<std::thread> threads;
+    for(std::size_t i{0u}; i < outputs.size(); ++i)
+        threads.emplace_back([&, i]() { outputs[i] = cache.firpm(spec); });
+    for(auto& it : threads)
+        it.join();
+    pm::cachestats_t st = cache.stats();
+    ASSERT_EQ(st.misses, 1u);
+    ASSERT_EQ(st.hits + st.coalesced, outputs.size() - 1u);
+    ASSERT_EQ(st.entries, 1u);
+    for(auto const& it : outputs) {
+        ASSERT_EQ(it.status, pm::status_t::STATUS_SUCCESS);
+        ASSERT_EQ(it.delta, outputs[0].delta);
+        ASSERT_EQ(it.h, outputs[0].h);
+    }
+
+    // a budget of about one design per shard evicts the older designs
+    pm::memcache_t<T> small(st.bytes + st.bytes / 2u, 1u);
+    small.firpm(spec);
+    spec.f[2] = 0.225;
+    small.firpm(spec);
+    st = small.stats();
+    ASSERT_EQ(st.entries, 1u);
+    ASSERT_EQ(st.evictions, 1u);
+    pmoutput_t<T> output;
+    ASSERT_TRUE(small.lookup(spec, output));
+    spec.f[2] = 0.22;
+    ASSERT_FALSE(small.lookup(spec, output));
+
+    // lookups are counted with the designs
+    st = small.stats();
+    ASSERT_EQ(st.hits, 1u);
+    ASSERT_EQ(st.misses, 3u);
+
+    // a request waiting for a design that gets cancelled designs the
+    // filter itself
+    pm::memcache_t<T> shared(1u << 20, 4u);
+    std::atomic<bool> cancel{false};
+    pm::pmspec_t<T> cancelled{spec};
+    cancelled.opts.cancel = &cancel;
+    pmoutput_t<T> waited;
+    std::thread waiter;
+    cancelled.opts.observer = [&](pm::pmprogress_t const&) {
+        if(!waiter.joinable()) {
+            waiter = std::thread([&]() { waited = shared.firpm(spec); });
+            while(shared.stats().coalesced == 0u)
+                std::this_thread::yield();
+            cancel = true;
+        }
+        return true;
+    };
+    output = shared.firpm(cancelled);
+    waiter.join();
+    ASSERT_EQ(output.status, pm::status_t::STATUS_INTERRUPTED);
+    ASSERT_EQ(waited.status, pm::status_t::STATUS_SUCCESS);
+    ASSERT_EQ(waited.h, pm::firpmspec(spec).h);
+    st = shared.stats();
+    ASSERT_EQ(st.coalesced, 1u);
+    ASSERT_EQ(st.misses, 2u);
+    ASSERT_EQ(st.entries, 1u);
+}
+
+TEST(firpm_cheby_test, cache) {
+
+    // the node cache drops its least recently used sets when it is full,
+    // those still held by a caller stay valid
+    auto p = pm::chebpts<double>(100u);
+    std::size_t n = pm::CHEBPTS_CACHE_SIZE / 2u + 1u;
+    auto q = pm::chebpts<double>(n, pm::FIRST);
+    ASSERT_EQ(q, pm::chebpts<double>(n, pm::FIRST));
+    q = pm::chebpts<double>(n, pm::SECOND);
+    auto r = pm::chebpts<double>(100u);
+    ASSERT_NE(p, r);
+    ASSERT_EQ(*p, *r);
+    ASSERT_EQ(r, pm::chebpts<double>(100u));
+    pm::chebptsclear<double>();
+}
+
+TEST(firpm_ddouble_test, acos) {
+
+    using pm::ddouble;
+    // acos(1 - e) = sqrt(2e) (1 + e/12 + 3e^2/160 + ...)
+    ddouble e{1e-20};
+    ddouble ref = pm::dd::sqrt(ldexp(e, 1)) * (ddouble(1.0) + e / ddouble(12.0));
+    ddouble a = pm::dd::acos(ddouble(1.0) - e);
+    ASSERT_LE(std::fabs(((a - ref) / ref).hi), 1e-30);
+    // near -1 the result is close to pi, only its relative accuracy matters
+    a = pm::dd::acos(e - ddouble(1.0));
+    ref = pm::dd::ddimpl::pi - ref;
+    ASSERT_LE(std::fabs(((a - ref) / ref).hi), 1e-30);
+    ASSERT_EQ(pm::dd::acos(ddouble(1.0)).hi, 0.0);
+    ASSERT_EQ(pm::dd::acos(ddouble(-1.0)).hi, pm::dd::ddimpl::pi.hi);
+    ddouble half = pm::dd::acos(ddouble(0.5)) * ddouble(3.0);
+    ASSERT_LE(std::fabs((half - pm::dd::ddimpl::pi).hi), 1e-30);
+}
+
+TEST(firpm_ddouble_test, tolong) {
+
+    using pm::ddouble;
+    ASSERT_EQ(static_cast<long>(ddouble(3.0, -1e-17)), 2l);
+    ASSERT_EQ(static_cast<long>(ddouble(-3.0, 1e-17)), -2l);
+    ASSERT_EQ(static_cast<long>(ddouble(3.0, 1e-17)), 3l);
+    ASSERT_EQ(static_cast<long>(ddouble(-3.0, -1e-17)), -3l);
+    ASSERT_EQ(static_cast<long>(ddouble(2.5)), 2l);
+    ASSERT_EQ(static_cast<long>(ddouble(-2.5)), -2l);
+}
+
+#ifdef HAVE_MPFR
+TEST(firpm_batch_mp_test, mixedprec) {
+
+    using T = mpfr::mpreal;
+    mpfr::mpreal::set_default_prec(64ul);
+    std::vector<pm::pmspec_t<T>> specs(4);
+    for(std::size_t i{0u}; i < specs.size(); ++i) {
+        specs[i].n = 60u;
+        specs[i].f = {0.0, 0.4, 0.5, 1.0};
+        specs[i].a = {1.0, 1.0, 0.0, 0.0};
+        specs[i].w = {1.0, 10.0};
+        specs[i].prec = (i % 2u == 0u) ? 100ul : 200ul;
+    }
+
+    auto outputs = pm::firpm_batch(specs);
+    // the precision of the calling thread is left untouched
+    ASSERT_EQ(mpfr::mpreal::get_default_prec(), 64);
+    for(std::size_t i{0u}; i < specs.size(); ++i) {
+        std::cout << "Final Delta     = " << outputs[i].delta << std::endl;
+        ASSERT_LT(outputs[i].q, 1e-2);
+        ASSERT_EQ(outputs[i].delta.get_prec(), (mpfr_prec_t)specs[i].prec);
+        ASSERT_EQ(outputs[i].h[0].get_prec(), (mpfr_prec_t)specs[i].prec);
+    }
+    mpfr::mpreal::set_default_prec(165ul);
+}
+
+// the MPFR kernels working on arena temporaries give the same values as the
+// generic code written with mpreal operations
+TEST(firpm_arena_mp_test, kernels) {
+
+    using T = mpfr::mpreal;
+    mpfr::mpreal::set_default_prec(200ul);
+    std::size_t n = 60u;
+    std::vector<T> x(n), C(n), D(n), W(n);
+    for(std::size_t i{0u}; i < n; ++i) {
+        x[i] = mpfr::cos(mpfr::const_pi() * T(n - 1u - i) / T(n - 1u));
+        C[i] = mpfr::sin(T(3 * i + 1));
+        D[i] = (i < n / 2u) ? T(1) : T(0);
+        W[i] = (i < n / 2u) ? T(1) : T(10);
+    }
+
+    // barycentric weights
+    std::vector<T> w(n);
+    pm::baryweights(w, x);
+    std::size_t step = (n - 2u) / 15 + 1;
+    for(std::size_t i{0u}; i < n; ++i) {
+        T denom = 1;
+        for(std::size_t j{0u}; j < step; ++j)
+            for(std::size_t k{j}; k < n; k += step)
+                if(k != i)
+                    denom *= ((x[i] - x[k]) << 1);
+        ASSERT_EQ(w[i], T(1) / denom);
+    }
+
+    // reference error
+    T delta, num = 0, denom = 0;
+    pm::compdelta(delta, w, D, W);
+    for(std::size_t i{0u}; i < n; ++i) {
+        num += w[i] * D[i];
+        T buffer = w[i] / W[i];
+        if(i % 2 == 0)
+            buffer = -buffer;
+        denom += buffer;
+    }
+    ASSERT_EQ(delta, num / denom);
+
+    // barycentric sums
+    std::vector<T> t(13u), Pc;
+    for(std::size_t k{0u}; k < t.size(); ++k)
+        t[k] = mpfr::cos(T(k) / T(5));
+    pm::approx(Pc, t, x, C, w);
+    for(std::size_t k{0u}; k < t.size(); ++k) {
+        T nn = 0, dd = 0;
+        for(std::size_t j{0u}; j < n; ++j) {
+            T buff = w[j] / (t[k] - x[j]);
+            nn += buff * C[j];
+            dd += buff;
+        }
+        ASSERT_EQ(Pc[k], nn / dd);
+    }
+
+    // Clenshaw recurrence, through the coefficients of a small CI
+    std::vector<T> fv(C.begin(), C.begin() + 20u), c(fv.size());
+    std::vector<T> p(fv);
+    pm::chebcoeffs(c, fv);
+    std::size_t m = p.size();
+    std::shared_ptr<const std::vector<T>> v = pm::chebpts<T>(m);
+    p[0] /= 2;
+    p[m - 1u] /= 2;
+    for(std::size_t i{0u}; i < m; ++i) {
+        T bn1 = p[m - 1u], bn2 = 0, bn;
+        for(int k{(int)m - 2}; k >= 1; --k) {
+            bn = (*v)[i] * 2;
+            bn = bn * bn1 - bn2 + p[k];
+            bn2 = bn1;
+            bn1 = bn;
+        }
+        T ci = (*v)[i] * bn1 - bn2 + p[0];
+        if(i == 0u || i == m - 1u) {
+            ci /= (m - 1u);
+        } else {
+            ci *= 2;
+            ci /= (m - 1u);
+        }
+        ASSERT_EQ(c[i], ci);
+    }
+    mpfr::mpreal::set_default_prec(165ul);
+}
+#endif